@@ -16,6 +16,22 @@ struct CommonConfig {
   std::vector<std::string> arbiter_public_key_paths;
   std::string registrar_verification_key_path;
   std::string tallyer_verification_key_path;
+  std::string dlog_table_path;
+  std::string group;
+
+  // Ballots must select between min_votes and max_votes candidates, shown
+  // with a sum proof. No limit (and no sum proof) when max_votes is 0.
+  int min_votes;
+  int max_votes;
+
+  // Send vote and decryption proofs as challenges and responses only.
+  bool compact_proofs;
+
+  // Request (voter) or accept (servers) an AES-GCM channel.
+  bool aead_channel;
+
+  // Seconds a session ticket stays valid for resumption; 0 disables tickets.
+  int session_ticket_lifetime;
 };
 CommonConfig load_common_config(std::string filename);
 
@@ -26,17 +42,28 @@ struct VoterConfig {
   std::string voter_registrar_signature_path;
   std::string voter_blind_path;
   std::string voter_number_path;
+  std::string voter_precompute_path;
+  int voter_precompute_size;
 
 };
 VoterConfig load_voter_config(std::string filename);
 
 struct RegistrarConfig {
   std::string registrar_signing_key_path;
+
+  // DH key pairs kept ready for key exchanges, and the pause in
+  // milliseconds between pairs generated in the background.
+  int dh_pool_size;
+  int dh_pool_refill_ms;
 };
 RegistrarConfig load_registrar_config(std::string filename);
 
 struct TallyerConfig {
   std::string tallyer_signing_key_path;
+
+  // As in RegistrarConfig.
+  int dh_pool_size;
+  int dh_pool_refill_ms;
 };
 TallyerConfig load_tallyer_config(std::string filename);
 
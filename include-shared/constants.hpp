@@ -6,11 +6,18 @@
 // In bytes
 #define SALT_SIZE 16  // 16 bytes = 128 bits
 #define PEPPER_SIZE 1 // 1 byte   = 8 bits
+#define SESSION_NONCE_SIZE 32 // nonces in session resumption
 
 // In bits
 #define EG_KEYSIZE 1024
 #define RSA_KEYSIZE 2048
 #define LAMBDA 128
+#define BATCH_LAMBDA 64 // random exponents in batch verification
+
+// Discrete log of the tally: baby steps in the table, and the largest tally
+// CombineResults will search for.
+#define DLOG_BABY_STEPS (1 << 20)
+#define DLOG_MAX_TALLY (1 << 26)
 
 // Primes from https://www.rfc-editor.org/rfc/rfc5114#page-4
 // Specifically, "2048-bit MODP Group with 256-bit Prime Order Subgroup"
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <crypto++/cryptlib.h>
+#include <crypto++/integer.h>
+#include <crypto++/modarith.h>
+
+// ================================================
+// FIXED-BASE EXPONENTIATION
+// ================================================
+
+// Precomputed powers base^(j * 2^(w*i)) for every w-bit window i of an
+// exponent in [0, order), stored in Montgomery form. An exponentiation then
+// costs one multiplication per nonzero window and no squarings.
+// The base must lie in the subgroup of the given order.
+class FixedBaseTable {
+public:
+  FixedBaseTable(const CryptoPP::Integer &base,
+                 const CryptoPP::Integer &modulus,
+                 const CryptoPP::Integer &order, unsigned int window_bits = 5);
+  CryptoPP::Integer Exponentiate(const CryptoPP::Integer &exponent) const;
+  const CryptoPP::Integer &GetBase() const;
+
+private:
+  CryptoPP::Integer base;
+  CryptoPP::Integer order;
+  CryptoPP::MontgomeryRepresentation mr;
+  unsigned int window_bits;
+  unsigned int windows;
+  std::vector<CryptoPP::Integer> table;
+};
+
+// ================================================
+// MULTI-EXPONENTIATION
+// ================================================
+
+// Computes prod bases[i]^exponents[i] mod modulus with Straus' method:
+// one shared chain of squarings, interleaved fixed windows per base.
+// Exponents must be non-negative and the modulus odd.
+CryptoPP::Integer
+MultiExponentiate(const std::vector<CryptoPP::Integer> &bases,
+                  const std::vector<CryptoPP::Integer> &exponents,
+                  const CryptoPP::Integer &modulus);
+
+// ================================================
+// BATCHED INVERSION
+// ================================================
+
+// Inverts every element of xs mod modulus with one modular inversion and
+// about 3n multiplications (Montgomery's trick). Throws std::invalid_argument
+// if any element is not invertible. The modulus must be odd.
+std::vector<CryptoPP::Integer>
+BatchInverse(const std::vector<CryptoPP::Integer> &xs,
+             const CryptoPP::Integer &modulus);
+
+// ================================================
+// MULTI-BUFFER EXPONENTIATION
+// ================================================
+
+// Independent exponentiations one pass of BatchExponentiate runs side by side.
+const size_t MODEXP_LANES = 8;
+
+// Computes bases[i]^exponents[i] mod modulus for every i. MODEXP_LANES
+// exponentiations run in lock step, one per vector lane, sharing their
+// squaring schedule; the kernel is built for AVX-512, AVX2 and baseline
+// x86-64 and the right one is picked at load time. Exponents must be
+// non-negative and the modulus odd. Running time depends on the exponents,
+// so this is meant for verifying public values.
+std::vector<CryptoPP::Integer>
+BatchExponentiate(const std::vector<CryptoPP::Integer> &bases,
+                  const std::vector<CryptoPP::Integer> &exponents,
+                  const CryptoPP::Integer &modulus);
+
+// ================================================
+// MONTGOMERY ARITHMETIC
+// ================================================
+
+// Montgomery arithmetic mod a fixed odd modulus, shared between threads.
+// Values in Montgomery form (x R mod m) can go through any number of
+// multiplications; conversion is only needed at the boundaries. Every call
+// runs on a thread-local copy of the Crypto++ workspace.
+class MontgomeryContext {
+public:
+  explicit MontgomeryContext(const CryptoPP::Integer &modulus);
+
+  const CryptoPP::Integer &GetModulus() const;
+  const CryptoPP::Integer &GetR() const; // R mod m, the form of 1
+  CryptoPP::Integer ConvertIn(const CryptoPP::Integer &x) const;
+  CryptoPP::Integer ConvertOut(const CryptoPP::Integer &x) const;
+  CryptoPP::Integer Multiply(const CryptoPP::Integer &x,
+                             const CryptoPP::Integer &y) const; // x y R^-1
+  CryptoPP::Integer Square(const CryptoPP::Integer &x) const;
+
+private:
+  const CryptoPP::MontgomeryRepresentation &Workspace() const;
+
+  CryptoPP::Integer modulus;
+  CryptoPP::Integer r;
+  CryptoPP::MontgomeryRepresentation prototype;
+  uint64_t id;                          // keys the per-thread workspaces
+  std::shared_ptr<const void> lifetime; // expires with the context
+};
+
+// Running product of residues mod the context's modulus, at one Montgomery
+// multiplication per factor. Factors go in as plain residues, so each one
+// leaves a factor R^-1 behind; the accumulated power of R is settled once
+// when the value is read.
+class MontgomeryProduct {
+public:
+  explicit MontgomeryProduct(std::shared_ptr<const MontgomeryContext> context);
+
+  void Multiply(const CryptoPP::Integer &x);
+  void Multiply(const MontgomeryProduct &other);
+  CryptoPP::Integer Value() const;
+
+private:
+  std::shared_ptr<const MontgomeryContext> context;
+  CryptoPP::Integer value; // product * R^-debt
+  uint64_t debt;
+};
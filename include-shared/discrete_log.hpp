@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <crypto++/cryptlib.h>
+#include <crypto++/integer.h>
+
+#include "../include-shared/group.hpp"
+
+// ================================================
+// BABY-STEP GIANT-STEP DISCRETE LOG
+// ================================================
+
+// Baby-step table for solving g^x = target with x in [0, max_exponent), g the
+// generator of the group. Holds the 64-bit fingerprint (low bits of the
+// element encoding) of g^j for every j in [0, baby_steps), sorted by
+// fingerprint so lookups are a binary search.
+// A solve then takes max_exponent / baby_steps giant-step multiplications.
+//
+// The table can be written to disk once and memory-mapped read-only by every
+// process that needs it; the file is in native byte order.
+class DiscreteLogTable {
+public:
+  struct Entry {
+    uint64_t fingerprint;
+    uint64_t exponent;
+  };
+
+  DiscreteLogTable(std::shared_ptr<const Group> group, uint64_t baby_steps);
+  static std::shared_ptr<DiscreteLogTable>
+  Load(const std::string &filename, std::shared_ptr<const Group> group);
+  void Save(const std::string &filename) const;
+
+  bool Solve(const CryptoPP::Integer &target, uint64_t max_exponent,
+             CryptoPP::Integer &exponent) const;
+  uint64_t GetBabySteps() const;
+
+private:
+  struct Header {
+    char magic[8];
+    uint64_t version;
+    uint64_t baby_steps;
+    uint64_t group_fingerprint;
+    uint64_t generator_fingerprint;
+  };
+
+  explicit DiscreteLogTable(std::shared_ptr<const Group> group);
+  Header MakeHeader() const;
+
+  std::shared_ptr<const Group> group;
+  uint64_t baby_steps;
+
+  // Either owned (freshly built) or pointing into the mapped file.
+  std::vector<Entry> owned;
+  boost::interprocess::file_mapping file;
+  boost::interprocess::mapped_region region;
+  const Entry *entries;
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <crypto++/cryptlib.h>
+#include <crypto++/eccrypto.h>
+#include <crypto++/ecp.h>
+#include <crypto++/integer.h>
+#include <crypto++/oids.h>
+
+#include "../include-shared/crypto_math.hpp"
+
+// ================================================
+// PRIME-ORDER GROUPS
+// ================================================
+
+// Running product of group elements, e.g. one candidate's column of
+// ciphertexts. Obtained from Group::NewAccumulator; only accumulators of the
+// same group may be multiplied together.
+class GroupAccumulator {
+public:
+  virtual ~GroupAccumulator() = default;
+  virtual void Mul(const CryptoPP::Integer &x) = 0;
+  virtual void Mul(const GroupAccumulator &other) = 0;
+  virtual CryptoPP::Integer Value() const = 0;
+};
+
+// A cyclic group of prime order with a fixed generator. Elements and scalars
+// are both carried as CryptoPP::Integer so that the messages and the hash
+// functions do not depend on the backend: a MODP element is its residue, an
+// elliptic curve point is its compressed SEC1 encoding read as a big-endian
+// integer (the point at infinity is 0).
+class Group {
+public:
+  virtual ~Group() = default;
+
+  virtual std::string Name() const = 0;
+  virtual const CryptoPP::Integer &Order() const = 0;
+  virtual const CryptoPP::Integer &Generator() const = 0;
+  virtual CryptoPP::Integer Identity() const = 0;
+
+  // True if x is the canonical encoding of a group element.
+  virtual bool IsElement(const CryptoPP::Integer &x) const = 0;
+
+  virtual CryptoPP::Integer Mul(const CryptoPP::Integer &x,
+                                const CryptoPP::Integer &y) const = 0;
+  virtual CryptoPP::Integer Inverse(const CryptoPP::Integer &x) const = 0;
+  // Inverses of all of xs; the default inverts them one by one.
+  virtual std::vector<CryptoPP::Integer>
+  BatchInverse(const std::vector<CryptoPP::Integer> &xs) const;
+  // g^-1, cached by backends where inversion is expensive.
+  virtual CryptoPP::Integer GeneratorInverse() const;
+  virtual CryptoPP::Integer Exp(const CryptoPP::Integer &x,
+                                const CryptoPP::Integer &e) const = 0;
+  virtual CryptoPP::Integer
+  MultiExp(const std::vector<CryptoPP::Integer> &bases,
+           const std::vector<CryptoPP::Integer> &exponents) const = 0;
+  // bases[i]^exponents[i] for every i; the default calls Exp on each.
+  virtual std::vector<CryptoPP::Integer>
+  BatchExp(const std::vector<CryptoPP::Integer> &bases,
+           const std::vector<CryptoPP::Integer> &exponents) const;
+
+  // Hint that x will be used as a base many times (e.g. the election key).
+  virtual void PrecomputeBase(const CryptoPP::Integer &x) const = 0;
+
+  // Fixed-width big-endian element encoding.
+  virtual size_t ElementSize() const = 0;
+  std::vector<unsigned char> ElementToBytes(const CryptoPP::Integer &x) const;
+  CryptoPP::Integer ElementFromBytes(const std::vector<unsigned char> &data) const;
+
+  CryptoPP::Integer ExpGenerator(const CryptoPP::Integer &e) const;
+
+  // Accumulator starting at the identity. The default one calls Mul.
+  virtual std::unique_ptr<GroupAccumulator> NewAccumulator() const;
+};
+
+// Subgroup of order q in Z_p^*. Exponentiations of g, and of the last base
+// passed to PrecomputeBase, go through fixed-base tables; accumulators stay in
+// Montgomery form mod p.
+class ModPGroup : public Group {
+public:
+  ModPGroup(const std::string &name, const CryptoPP::Integer &p,
+            const CryptoPP::Integer &q, const CryptoPP::Integer &g);
+
+  std::string Name() const override;
+  const CryptoPP::Integer &Order() const override;
+  const CryptoPP::Integer &Generator() const override;
+  CryptoPP::Integer Identity() const override;
+  bool IsElement(const CryptoPP::Integer &x) const override;
+  CryptoPP::Integer Mul(const CryptoPP::Integer &x,
+                        const CryptoPP::Integer &y) const override;
+  CryptoPP::Integer Inverse(const CryptoPP::Integer &x) const override;
+  std::vector<CryptoPP::Integer>
+  BatchInverse(const std::vector<CryptoPP::Integer> &xs) const override;
+  CryptoPP::Integer GeneratorInverse() const override;
+  CryptoPP::Integer Exp(const CryptoPP::Integer &x,
+                        const CryptoPP::Integer &e) const override;
+  CryptoPP::Integer
+  MultiExp(const std::vector<CryptoPP::Integer> &bases,
+           const std::vector<CryptoPP::Integer> &exponents) const override;
+  std::vector<CryptoPP::Integer>
+  BatchExp(const std::vector<CryptoPP::Integer> &bases,
+           const std::vector<CryptoPP::Integer> &exponents) const override;
+  void PrecomputeBase(const CryptoPP::Integer &x) const override;
+  size_t ElementSize() const override;
+  std::unique_ptr<GroupAccumulator> NewAccumulator() const override;
+
+private:
+  std::string name;
+  CryptoPP::Integer p;
+  CryptoPP::Integer q;
+  CryptoPP::Integer g;
+  CryptoPP::Integer g_inv;
+  FixedBaseTable g_table;
+  std::shared_ptr<const MontgomeryContext> p_context;
+
+  mutable std::mutex base_mtx;
+  mutable std::shared_ptr<const FixedBaseTable> base_table;
+};
+
+// Prime-order elliptic curve group over a Crypto++ named curve.
+class ECGroup : public Group {
+public:
+  ECGroup(const std::string &name, const CryptoPP::OID &curve);
+
+  std::string Name() const override;
+  const CryptoPP::Integer &Order() const override;
+  const CryptoPP::Integer &Generator() const override;
+  CryptoPP::Integer Identity() const override;
+  bool IsElement(const CryptoPP::Integer &x) const override;
+  CryptoPP::Integer Mul(const CryptoPP::Integer &x,
+                        const CryptoPP::Integer &y) const override;
+  CryptoPP::Integer Inverse(const CryptoPP::Integer &x) const override;
+  CryptoPP::Integer Exp(const CryptoPP::Integer &x,
+                        const CryptoPP::Integer &e) const override;
+  CryptoPP::Integer
+  MultiExp(const std::vector<CryptoPP::Integer> &bases,
+           const std::vector<CryptoPP::Integer> &exponents) const override;
+  void PrecomputeBase(const CryptoPP::Integer &x) const override;
+  size_t ElementSize() const override;
+
+private:
+  const CryptoPP::ECP &Curve() const;
+  bool Decode(const CryptoPP::Integer &x, CryptoPP::ECP::Point &point) const;
+  CryptoPP::ECP::Point Decode(const CryptoPP::Integer &x) const;
+  CryptoPP::Integer Encode(const CryptoPP::ECP::Point &point) const;
+
+  std::string name;
+  CryptoPP::DL_GroupParameters_EC<CryptoPP::ECP> params;
+  CryptoPP::Integer order;
+  CryptoPP::Integer generator;
+  uint64_t id;                          // keys the per-thread curve copies
+  std::shared_ptr<const void> lifetime; // expires with the group
+};
+
+// Group names accepted in the common config.
+#define GROUP_MODP_2048 "modp2048"
+#define GROUP_SECP256R1 "secp256r1"
+
+std::shared_ptr<const Group> MakeGroup(const std::string &name);
+
+// The group used for election keys, votes and decryptions. Set once at
+// startup from CommonConfig::group; defaults to the MODP group.
+void SetElectionGroup(const std::string &name);
+const std::shared_ptr<const Group> &ElectionGroup();
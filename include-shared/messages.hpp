@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -37,31 +39,124 @@ enum T {
   Multi_Integer = 15,
   Multi_String = 16,
   VoterToRegistrar_Register_Messages = 17,
-  RegistrarToVoter_Blind_Signature_Messages = 18
+  RegistrarToVoter_Blind_Signature_Messages = 18,
+  SumZKP_Struct = 19,
+  VoteZKP_Compact = 20,
+  DecryptionZKP_Compact = 21,
+  AEADTagged_Wrapper = 22,
+  UserToServer_Resume_Message = 23,
+  ServerToUser_Resume_Message = 24,
+  Multi_Vote_Ciphertext_Counted = 25,
+  Multi_VoteZKP_Counted = 26,
+  Multi_Integer_Counted = 27,
+  Multi_String_Counted = 28
 };
 };
+
+// How the channel is protected after the key exchange: AES-CBC with a
+// separate HMAC, or AES-GCM over the serialized message in one pass.
+namespace ChannelMode {
+enum T { CBC_HMAC = 0, AES_GCM = 1 };
+};
+
+// How integers are written. DECIMAL is the original length-prefixed decimal
+// string; BINARY is big-endian bytes. The version sits in the top byte of
+// the length word, which is zero in every DECIMAL length.
+namespace WireVersion {
+enum T { DECIMAL = 0, BINARY = 1 };
+};
 MessageType::T get_message_type(std::vector<unsigned char> &data);
 
-const char delimiter = '.';
 // ================================================
 // SERIALIZABLE
 // ================================================
 
+// Cursor over serialized bytes. Each read returns the next field and moves
+// past it; byte fields come back as views into the input, so nothing is
+// copied until a field is turned into its final type. Reads past the end
+// throw std::runtime_error.
+class ByteReader {
+public:
+  explicit ByteReader(std::span<const unsigned char> data);
+
+  bool AtEnd() const;
+  size_t Consumed() const;
+  size_t Remaining() const;
+  unsigned char Peek() const;
+
+  // Reads the type byte and throws if it is not type.
+  void Expect(MessageType::T type);
+  unsigned char ReadByte();
+  bool ReadBool();
+  std::span<const unsigned char> ReadBytes(size_t n);
+  size_t ReadSize(); // a length or count word
+  std::span<const unsigned char> ReadField(); // as written by put_string
+  std::string ReadString();
+  CryptoPP::SecByteBlock ReadByteBlock();
+  CryptoPP::Integer ReadInteger(WireVersion::T *version = nullptr);
+  ByteReader ReadNested(); // over a length-prefixed run of fields
+
+  // Reads a Multi_* container's type byte, which must be type or
+  // counted_type, and its header; returns a reader over just its elements.
+  // count is the element count, or 0 for the uncounted form.
+  ByteReader ReadContainer(MessageType::T type, MessageType::T counted_type,
+                           bool *counted, size_t *count);
+  // Moves past the next Multi_* container without parsing its elements.
+  void SkipContainer();
+
+private:
+  std::span<const unsigned char> data;
+  size_t pos;
+};
+
 struct Serializable {
-  virtual void serialize(std::vector<unsigned char> &data) = 0;
-  virtual int deserialize(std::vector<unsigned char> &data) = 0;
+  // Appends the struct to data after reserving room for all of it.
+  void serialize(std::vector<unsigned char> &data);
+  // Exact number of bytes write appends.
+  virtual size_t serialized_size() = 0;
+  // Appends the struct to data; nested structs are written the same way,
+  // straight into their parent's buffer.
+  virtual void write(std::vector<unsigned char> &data) = 0;
+  // Reads the struct from the front of data; returns the bytes it used.
+  int deserialize(std::span<const unsigned char> data);
+  virtual void read(ByteReader &reader) = 0;
+
+  // Integer encoding used by serialize. deserialize sets it to the encoding
+  // it read, so a decoded struct serializes back to the same bytes and old
+  // signatures over it still verify.
+  WireVersion::T wire_version = WireVersion::BINARY;
 };
 
 // serializers.
 int put_bool(bool b, std::vector<unsigned char> &data);
-int put_string(std::string s, std::vector<unsigned char> &data);
-int put_integer(CryptoPP::Integer i, std::vector<unsigned char> &data);
+int put_string(const std::string &s, std::vector<unsigned char> &data);
+int put_bytes(std::span<const unsigned char> b,
+              std::vector<unsigned char> &data); // read back with ReadField
+int put_integer(CryptoPP::Integer i, std::vector<unsigned char> &data,
+                WireVersion::T version = WireVersion::BINARY);
+// Group elements and scalars are padded to the election group's element
+// and order widths.
+int put_element(const CryptoPP::Integer &x, std::vector<unsigned char> &data,
+                WireVersion::T version = WireVersion::BINARY);
+int put_scalar(const CryptoPP::Integer &x, std::vector<unsigned char> &data,
+               WireVersion::T version = WireVersion::BINARY);
+
+// Sizes of what the serializers above put.
+size_t string_size(size_t length);
+size_t integer_size(const CryptoPP::Integer &i,
+                    WireVersion::T version = WireVersion::BINARY);
+size_t element_size(const CryptoPP::Integer &x,
+                    WireVersion::T version = WireVersion::BINARY);
+size_t scalar_size(const CryptoPP::Integer &x,
+                   WireVersion::T version = WireVersion::BINARY);
+// Size of the count and length words in front of a counted container.
+size_t container_header_size();
 
 // deserializers
 int get_bool(bool *b, std::vector<unsigned char> &data, int idx);
 int get_string(std::string *s, std::vector<unsigned char> &data, int idx);
 int get_integer(CryptoPP::Integer *i, std::vector<unsigned char> &data,
-                int idx);
+                int idx, WireVersion::T *version = nullptr);
 
 // ================================================
 // WRAPPERS
@@ -72,8 +167,9 @@ struct HMACTagged_Wrapper : public Serializable {
   CryptoPP::SecByteBlock iv;
   std::string mac;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // Struct for a vote, v, as an
@@ -82,32 +178,43 @@ struct Vote_Ciphertext : public Serializable {
   CryptoPP::Integer a;
   CryptoPP::Integer b;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 //struct for votes
 struct Multi_Vote_Ciphertext : public Serializable {
   std::vector<Vote_Ciphertext> ct;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  // Write the element count and byte length up front. Containers read in the
+  // older form, which runs to the end of its buffer, keep it so they
+  // serialize back to the same bytes.
+  bool counted = true;
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 //struct for multiple integer
 struct Multi_Integer : public Serializable {
     std::vector<CryptoPP::Integer> ints;
+    bool counted = true; // as in Multi_Vote_Ciphertext
 
-    void serialize(std::vector<unsigned char> &data);
-    int deserialize(std::vector<unsigned char> &data);
+    size_t serialized_size();
+    void write(std::vector<unsigned char> &data);
+    void read(ByteReader &reader);
 };
 
 // struct for multiple string
 struct Multi_String : public Serializable{
   std::vector<std::string> strings;
+  bool counted = true; // as in Multi_Vote_Ciphertext
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 // ================================================
 // KEY EXCHANGE
@@ -115,18 +222,47 @@ struct Multi_String : public Serializable{
 
 struct UserToServer_DHPublicValue_Message : public Serializable {
   CryptoPP::SecByteBlock public_value;
+  ChannelMode::T channel_mode = ChannelMode::CBC_HMAC; // requested
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 struct ServerToUser_DHPublicValue_Message : public Serializable {
   CryptoPP::SecByteBlock server_public_value;
   CryptoPP::SecByteBlock user_public_value;
-  std::string server_signature; // computed on server_value + user_value
+  ChannelMode::T channel_mode = ChannelMode::CBC_HMAC; // chosen by the server
+  std::string server_signature; // computed on server_value + user_value + mode
+  std::string session_ticket;   // opaque; empty if the server issues none
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
+};
+
+// Sent instead of UserToServer_DHPublicValue_Message to resume the session
+// a ticket was issued for.
+struct UserToServer_Resume_Message : public Serializable {
+  std::string session_ticket;
+  CryptoPP::SecByteBlock client_nonce;
+  ChannelMode::T channel_mode = ChannelMode::CBC_HMAC; // requested
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
+};
+
+// If not accepted, the client continues with a full key exchange.
+struct ServerToUser_Resume_Message : public Serializable {
+  bool accepted;
+  CryptoPP::SecByteBlock server_nonce;
+  ChannelMode::T channel_mode = ChannelMode::CBC_HMAC; // chosen by the server
+  std::string server_confirmation; // HMAC on client_nonce + server_nonce + mode
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // ================================================
@@ -138,8 +274,9 @@ struct VoterToRegistrar_Register_Message : public Serializable {
 //   std::string candidate_id;
   CryptoPP::Integer vote;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 struct RegistrarToVoter_Blind_Signature_Message : public Serializable {
@@ -147,16 +284,18 @@ struct RegistrarToVoter_Blind_Signature_Message : public Serializable {
 //   std::string candidate_id;
   CryptoPP::Integer registrar_signature;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 struct VoterToRegistrar_Register_Messages : public Serializable {
   std::string id;
   Multi_Integer votes;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 
@@ -164,8 +303,9 @@ struct RegistrarToVoter_Blind_Signature_Messages : public Serializable {
   std::string id;
   Multi_Integer registrar_signatures;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // ================================================
@@ -184,15 +324,40 @@ struct VoteZKP_Struct : public Serializable {
   CryptoPP::Integer r0;
   CryptoPP::Integer r1;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  // Serialize only (c0, c1, r0, r1); verifiers recompute the commitments.
+  bool compact = false;
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
+};
+
+// Struct for a proof that the product (A, B) of a ballot's t ciphertexts
+// encrypts some k in [min_votes, max_votes]: one Chaum-Pedersen branch per
+// allowed k, all but the real one simulated. Branch j (k = min_votes + j)
+// satisfies g^r[j] = a[j] * A^c[j] and pk^r[j] = b[j] * (B / g^k)^c[j].
+struct SumZKP_Struct : public Serializable {
+  std::vector<CryptoPP::Integer> a;
+  std::vector<CryptoPP::Integer> b;
+  std::vector<CryptoPP::Integer> c;
+  std::vector<CryptoPP::Integer> r;
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
+// Per-candidate 0/1 proofs, followed by the ballot's sum proof when the
+// election limits how many candidates a voter may choose. The count covers
+// the per-candidate proofs only.
 struct Multi_VoteZKP_Struct : public Serializable {
   std::vector<VoteZKP_Struct> zkp;
+  std::optional<SumZKP_Struct> sum;
+  bool counted = true; // as in Multi_Vote_Ciphertext
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 
@@ -208,8 +373,9 @@ struct VoterToTallyer_Vote_Message : public Serializable {
   Multi_Vote_Ciphertext votes;
   Multi_Integer unblinded_signatures;
   Multi_VoteZKP_Struct zkps;
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // struct TallyerToWorld_Vote_Message : public Serializable {
@@ -230,8 +396,9 @@ struct TallyerToWorld_Vote_Message : public Serializable {
 //   Multi_String tallyer_signatures;  // each tallyer_signature computed on vote || zkp || unblinded_signature
   std::string tallyer_signatures;  // tallyer_signature computed on votes || zkps || unblinded_signatures
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // ================================================
@@ -243,18 +410,25 @@ struct PartialDecryption_Struct : public Serializable {
   CryptoPP::Integer d;
   Vote_Ciphertext aggregate_ciphertext;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
-// Struct for a pd zkp of vote (a, b): (u, v, s) = (a^r, g^r, s)
+// Struct for a pd zkp of vote (a, b): (u, v, s) = (a^r, g^r, s), with
+// challenge c = H(pk, a, b, u, v)
 struct DecryptionZKP_Struct : public Serializable {
   CryptoPP::Integer u;
   CryptoPP::Integer v;
   CryptoPP::Integer s;
+  CryptoPP::Integer c;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  // Serialize only (c, s); verifiers recompute u and v.
+  bool compact = false;
+
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 struct ArbiterToWorld_PartialDecryption_Message : public Serializable {
@@ -263,8 +437,9 @@ struct ArbiterToWorld_PartialDecryption_Message : public Serializable {
   PartialDecryption_Struct dec;
   DecryptionZKP_Struct zkp;
 
-  void serialize(std::vector<unsigned char> &data);
-  int deserialize(std::vector<unsigned char> &data);
+  size_t serialized_size();
+  void write(std::vector<unsigned char> &data);
+  void read(ByteReader &reader);
 };
 
 // ================================================
@@ -274,6 +449,8 @@ struct ArbiterToWorld_PartialDecryption_Message : public Serializable {
 std::vector<unsigned char> concat_byteblocks(CryptoPP::SecByteBlock &b1,
                                              CryptoPP::SecByteBlock &b2);
 std::vector<unsigned char>
+concat_dh_values_and_mode(ServerToUser_DHPublicValue_Message &msg);
+std::vector<unsigned char>
 concat_vote_zkp_and_signature(Vote_Ciphertext &vote, VoteZKP_Struct &zkp,
                               CryptoPP::Integer &signature);
 
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <crypto++/cryptlib.h>
+
+// ================================================
+// THREAD-LOCAL RANDOMNESS
+// ================================================
+
+// The calling thread's generator: an AutoSeededRandomPool seeded from the OS
+// on first use, reseeded after RNG_RESEED_CALLS uses or RNG_RESEED_SECONDS
+// seconds, and immediately in a child process after fork(). The reference
+// must stay on the calling thread.
+CryptoPP::RandomNumberGenerator &ThreadRNG();
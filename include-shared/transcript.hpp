@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <crypto++/cryptlib.h>
+#include <crypto++/integer.h>
+#include <crypto++/sha.h>
+
+#include "../include-shared/group.hpp"
+
+// ================================================
+// FIAT-SHAMIR TRANSCRIPT
+// ================================================
+
+// SHA-256 transcript for Fiat-Shamir challenges. The domain names the proof
+// and the group; every value is preceded by its tag and its width and written
+// as fixed-width big-endian bytes, so two different transcripts can never
+// hash the same byte string.
+class Transcript {
+public:
+  Transcript(const std::string &domain, const Group &group);
+
+  void AbsorbElement(const std::string &tag, const CryptoPP::Integer &x);
+  void AbsorbUint(const std::string &tag, uint64_t x);
+
+  // Challenge in [0, q). Draws 512 bits so the reduction is unbiased.
+  CryptoPP::Integer Challenge();
+
+private:
+  void Absorb(const std::string &tag, const CryptoPP::Integer &x,
+              size_t width);
+  void AbsorbLabel(const std::string &label);
+
+  const Group &group;
+  CryptoPP::SHA256 hash;
+};
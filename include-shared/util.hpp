@@ -40,13 +40,3 @@ void print_key_as_hex(CryptoPP::SecByteBlock block);
 
 // Splitter.
 std::vector<std::string> string_split(std::string str, char delimiter);
-
-// Hasher.
-CryptoPP::Integer hash_vote_zkp(CryptoPP::Integer pk, CryptoPP::Integer a,
-                                CryptoPP::Integer b, CryptoPP::Integer a0_p,
-                                CryptoPP::Integer b0_p, CryptoPP::Integer a1_p,
-                                CryptoPP::Integer b1_p);
-
-CryptoPP::Integer hash_dec_zkp(CryptoPP::Integer pk, CryptoPP::Integer a,
-                               CryptoPP::Integer b, CryptoPP::Integer u,
-                               CryptoPP::Integer v);
@@ -2,9 +2,15 @@
 
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 
 #include <crypto++/cryptlib.h>
 #include <crypto++/dh.h>
@@ -12,6 +18,7 @@
 #include <crypto++/elgamal.h>
 #include <crypto++/files.h>
 #include <crypto++/filters.h>
+#include <crypto++/gcm.h>
 #include <crypto++/hex.h>
 #include <crypto++/hkdf.h>
 #include <crypto++/hmac.h>
@@ -19,17 +26,74 @@
 #include <crypto++/modes.h>
 #include <crypto++/nbtheory.h>
 #include <crypto++/osrng.h>
+#include <crypto++/pssr.h>
 #include <crypto++/rijndael.h>
 #include <crypto++/rsa.h>
 #include <crypto++/sha.h>
 #include <crypto++/sha3.h>
 
+#include "../../include-shared/crypto_math.hpp"
 #include "../../include-shared/messages.hpp"
 
 using namespace CryptoPP;
 
+// RSA signing state for one private key, built once and shared by every
+// connection. Holds the PSS signer and the CRT components used for blind
+// signing; all methods are const and safe to call concurrently.
+class RSASignerHandle {
+public:
+  explicit RSASignerHandle(const RSA::PrivateKey &signing_key);
+
+  std::string Sign(std::span<const unsigned char> message) const;
+  CryptoPP::Integer BlindSign(const CryptoPP::Integer &blinded_msg) const;
+
+private:
+  RSASS<PSS, SHA256>::Signer signer;
+
+  CryptoPP::Integer n, e, d;
+  CryptoPP::Integer p, q, dp, dq, q_inv; // q_inv = q^-1 mod p
+  bool has_crt;
+};
+
+// RSA verification state for one public key, built once when the key is
+// loaded. Holds the PSS verifier and a Montgomery context for n, used to
+// apply the public exponent in blind-signature checks; all methods are const
+// and safe to call concurrently.
+class RSAVerifierHandle {
+public:
+  explicit RSAVerifierHandle(const RSA::PublicKey &verification_key);
+
+  bool Verify(std::span<const unsigned char> message,
+              std::span<const unsigned char> signature) const;
+  CryptoPP::Integer ApplyFunction(const CryptoPP::Integer &x) const; // x^e
+  std::vector<CryptoPP::Integer>
+  ApplyFunctionBatch(const std::vector<CryptoPP::Integer> &xs) const;
+
+  const CryptoPP::Integer &GetModulus() const;
+  bool CanScreenBatches() const;
+
+private:
+  RSASS<PSS, SHA256>::Verifier verifier;
+
+  CryptoPP::Integer n, e;
+  std::unique_ptr<MontgomeryContext> n_context; // null unless n is odd
+  bool screen_batches;
+};
+
+// A resumption ticket as held by a client: the server's opaque ticket and
+// the secret it wraps. Empty until a server has issued one.
+struct SessionTicket {
+  std::string ticket;
+  SecByteBlock secret;
+};
+
 class CryptoDriver {
 public:
+  // Mode used by encrypt_and_tag and decrypt_and_verify; set once the key
+  // exchange has agreed on one.
+  void set_channel_mode(ChannelMode::T mode);
+  ChannelMode::T get_channel_mode() const;
+
   std::vector<unsigned char> encrypt_and_tag(SecByteBlock AES_key,
                                              SecByteBlock HMAC_key,
                                              Serializable *message);
@@ -37,6 +101,11 @@ public:
   decrypt_and_verify(SecByteBlock AES_key, SecByteBlock HMAC_key,
                      std::vector<unsigned char> ciphertext_data);
 
+  std::vector<unsigned char> AEAD_encrypt(SecByteBlock key,
+                                          Serializable *message);
+  std::pair<std::vector<unsigned char>, bool>
+  AEAD_decrypt(SecByteBlock key, std::vector<unsigned char> ciphertext_data);
+
   std::tuple<DH, SecByteBlock, SecByteBlock> DH_initialize();
   SecByteBlock
   DH_generate_shared_key(const DH &DH_obj, const SecByteBlock &DH_private_value,
@@ -49,6 +118,31 @@ public:
                           std::string ciphertext);
 
   SecByteBlock HMAC_generate_key(const SecByteBlock &DH_shared_key);
+
+  SecByteBlock SESSION_generate_secret(const SecByteBlock &DH_shared_key);
+  SecByteBlock SESSION_generate_ticket_key();
+  SecByteBlock SESSION_generate_nonce();
+  std::string SESSION_seal_ticket(const SecByteBlock &ticket_key,
+                                  const SecByteBlock &secret, int lifetime);
+  std::pair<SecByteBlock, bool>
+  SESSION_open_ticket(const SecByteBlock &ticket_key,
+                      const std::string &ticket);
+  std::pair<ServerToUser_Resume_Message, std::pair<SecByteBlock, SecByteBlock>>
+  SESSION_resume(const SecByteBlock &ticket_key,
+                 const UserToServer_Resume_Message &resume, bool allow_aead);
+  std::pair<SecByteBlock, SecByteBlock>
+  SESSION_derive_keys(const SecByteBlock &secret,
+                      const SecByteBlock &client_nonce,
+                      const SecByteBlock &server_nonce);
+  std::string SESSION_confirmation(SecByteBlock HMAC_key,
+                                   const SecByteBlock &client_nonce,
+                                   const SecByteBlock &server_nonce,
+                                   ChannelMode::T mode);
+  bool SESSION_verify_confirmation(SecByteBlock HMAC_key,
+                                   const SecByteBlock &client_nonce,
+                                   const SecByteBlock &server_nonce,
+                                   ChannelMode::T mode,
+                                   const std::string &confirmation);
   std::string HMAC_generate(SecByteBlock key, std::string ciphertext);
   bool HMAC_verify(SecByteBlock key, std::string ciphertext, std::string hmac);
 
@@ -57,18 +151,62 @@ public:
   std::pair<RSA::PrivateKey, RSA::PublicKey> RSA_generate_keys();
   std::string RSA_sign(const RSA::PrivateKey &RSA_signing_key,
                        std::vector<unsigned char> message);
+  std::string RSA_sign(const RSASignerHandle &signer,
+                       std::span<const unsigned char> message);
   bool RSA_verify(const RSA::PublicKey &verification_key,
                   std::vector<unsigned char> message, std::string signature);
+  bool RSA_verify(const RSAVerifierHandle &verifier,
+                  std::span<const unsigned char> message,
+                  const std::string &signature);
 
   std::pair<CryptoPP::Integer, CryptoPP::Integer>
   RSA_BLIND_blind(const RSA::PublicKey &pk, Serializable &msg);
   CryptoPP::Integer RSA_BLIND_sign(const RSA::PrivateKey &sk,
                                    CryptoPP::Integer blinded_msg);
+  CryptoPP::Integer RSA_BLIND_sign(const RSASignerHandle &signer,
+                                   CryptoPP::Integer blinded_msg);
   CryptoPP::Integer RSA_BLIND_unblind(const RSA::PublicKey &pk,
                                       CryptoPP::Integer signed_blind_msg,
                                       CryptoPP::Integer blind);
   bool RSA_BLIND_verify(const RSA::PublicKey &pk, Serializable &msg,
                         CryptoPP::Integer signature);
+  bool RSA_BLIND_verify(const RSAVerifierHandle &verifier, Serializable &msg,
+                        const CryptoPP::Integer &signature);
+  std::vector<bool>
+  RSA_BLIND_verify_batch(const RSA::PublicKey &pk,
+                         const std::vector<Serializable *> &msgs,
+                         std::span<const CryptoPP::Integer> signatures);
+  std::vector<bool>
+  RSA_BLIND_verify_batch(const RSAVerifierHandle &verifier,
+                         const std::vector<Serializable *> &msgs,
+                         std::span<const CryptoPP::Integer> signatures);
 
   SecByteBlock FDH_hash(SecByteBlock input, int domain_size);
+
+private:
+  ChannelMode::T channel_mode = ChannelMode::CBC_HMAC;
+};
+
+// DH key pairs generated ahead of time on a background thread, so a server's
+// key exchange does not wait for one. The thread keeps up to `size` pairs
+// ready, pausing refill_ms between pairs; Pop generates a pair inline when
+// the pool is empty (always, if size is 0).
+class DHKeyPool {
+public:
+  DHKeyPool(size_t size, int refill_ms);
+  ~DHKeyPool();
+
+  std::tuple<DH, SecByteBlock, SecByteBlock> Pop();
+
+private:
+  void Refill();
+
+  size_t size;
+  std::chrono::milliseconds refill_interval;
+
+  std::mutex mtx;
+  std::condition_variable refill;
+  std::deque<std::tuple<DH, SecByteBlock, SecByteBlock>> pairs;
+  bool stopping;
+  std::thread worker;
 };
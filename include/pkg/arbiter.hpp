@@ -34,6 +34,8 @@ private:
   CryptoPP::Integer EG_arbiter_public_key_i; // Our EG public key
   CryptoPP::RSA::PublicKey RSA_registrar_verification_key;
   CryptoPP::RSA::PublicKey RSA_tallyer_verification_key;
+  std::shared_ptr<RSAVerifierHandle> RSA_registrar_verifier;
+  std::shared_ptr<RSAVerifierHandle> RSA_tallyer_verifier;
 
    int t;// t candidate for voting 
 };
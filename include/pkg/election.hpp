@@ -16,12 +16,50 @@
 #include "../../include/drivers/cli_driver.hpp"
 #include "../../include/drivers/db_driver.hpp"
 
+// Everything GenerateVote needs that depends only on fresh randomness and pk:
+// the encryption randomness r, the real branch commitment w, and a complete
+// simulated branch (c_sim, r_sim) with its commitments folded into powers of
+// g and pk. Each tuple must be used for exactly one ballot.
+struct VotePrecomputation {
+  CryptoPP::Integer r;
+  CryptoPP::Integer g_r;  // g^r
+  CryptoPP::Integer pk_r; // pk^r
+  CryptoPP::Integer w;
+  CryptoPP::Integer g_w;  // g^w
+  CryptoPP::Integer pk_w; // pk^w
+  CryptoPP::Integer c_sim;
+  CryptoPP::Integer r_sim;
+  CryptoPP::Integer g_sim;       // g^(r_sim - r c_sim)
+  CryptoPP::Integer pk_sim;      // pk^(r_sim - r c_sim)
+  CryptoPP::Integer g_c_sim;     // g^c_sim
+  CryptoPP::Integer g_neg_c_sim; // g^-c_sim
+};
+
 class ElectionClient {
 public:
   static std::pair<Vote_Ciphertext, VoteZKP_Struct>
   GenerateVote(CryptoPP::Integer vote, CryptoPP::Integer pk);
+  static std::pair<Multi_Vote_Ciphertext, Multi_VoteZKP_Struct>
+  GenerateBallot(std::vector<CryptoPP::Integer> votes, CryptoPP::Integer pk,
+                 int min_votes, int max_votes);
+  static VotePrecomputation PrecomputeVote(CryptoPP::Integer pk);
+  static void StartVotePrecomputation(CryptoPP::Integer pk, size_t pool_size);
+  static void SaveVotePrecomputations(std::string path, CryptoPP::Integer pk,
+                                      size_t count);
+  static size_t LoadVotePrecomputations(std::string path,
+                                        CryptoPP::Integer pk);
   static bool VerifyVoteZKP(std::pair<Vote_Ciphertext, VoteZKP_Struct> vote,
                             CryptoPP::Integer pk);
+  static std::vector<bool> VerifyVoteZKPBatch(
+      std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes,
+      CryptoPP::Integer pk);
+  static bool VerifyBallotSum(const Multi_Vote_Ciphertext &votes,
+                              const Multi_VoteZKP_Struct &zkps,
+                              CryptoPP::Integer pk, int min_votes,
+                              int max_votes);
+  static std::vector<bool> VerifyBallotBatch(const std::vector<VoteRow> &ballots,
+                                             CryptoPP::Integer pk,
+                                             int min_votes, int max_votes);
 
   static std::pair<PartialDecryption_Struct, DecryptionZKP_Struct>
   PartialDecrypt(Vote_Ciphertext combined_vote, CryptoPP::Integer pk,
@@ -30,8 +68,15 @@ public:
   VerifyPartialDecryptZKP(ArbiterToWorld_PartialDecryption_Message a2w_dec_s,
                           CryptoPP::Integer pki);
 
-  static std::vector<Vote_Ciphertext> CombineVotes(std::vector<VoteRow> all_votes);
+  static void UseCompactProofs(bool compact);
+  static void UseDiscreteLogTable(std::string path);
+  static size_t CandidateCount(const std::vector<VoteRow> &all_votes);
+  static std::vector<Vote_Ciphertext>
+  CombineVotes(const std::vector<VoteRow> &all_votes, size_t candidates);
   static CryptoPP::Integer
   CombineResults(Vote_Ciphertext combined_vote,
                  std::vector<PartialDecryptionRow> all_partial_decryptions);
+  static std::vector<CryptoPP::Integer> CombineResultsBatch(
+      std::vector<Vote_Ciphertext> combined_votes,
+      std::vector<std::vector<PartialDecryptionRow>> all_partial_decryptions);
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+
 #include <crypto++/cryptlib.h>
 #include <crypto++/dh.h>
 #include <crypto++/dh2.h>
@@ -34,6 +35,9 @@ private:
 
   CryptoPP::Integer EG_arbiter_public_key; // The election's EG public key
   CryptoPP::RSA::PrivateKey RSA_registrar_signing_key;
+  std::shared_ptr<RSASignerHandle> RSA_registrar_signer; // built once from the key
+  CryptoPP::SecByteBlock session_ticket_key; // seals session tickets
+  std::shared_ptr<DHKeyPool> dh_pool;
   CryptoPP::RSA::PublicKey RSA_registrar_verification_key;
   CryptoPP::RSA::PublicKey RSA_tallyer_verification_key;
 
@@ -1,5 +1,6 @@
 #pragma once
 
+
 #include <crypto++/cryptlib.h>
 #include <crypto++/dh.h>
 #include <crypto++/dh2.h>
@@ -34,7 +35,11 @@ private:
 
   CryptoPP::Integer EG_arbiter_public_key; // The election's EG public key
   CryptoPP::RSA::PublicKey RSA_registrar_verification_key;
+  std::shared_ptr<RSAVerifierHandle> RSA_registrar_verifier;
   CryptoPP::RSA::PrivateKey RSA_tallyer_signing_key;
+  std::shared_ptr<RSASignerHandle> RSA_tallyer_signer; // built once from the key
+  CryptoPP::SecByteBlock session_ticket_key; // seals session tickets
+  std::shared_ptr<DHKeyPool> dh_pool;
   CryptoPP::RSA::PublicKey RSA_tallyer_verification_key;
 
   void ListenForConnections(int port);
@@ -23,10 +23,11 @@ public:
               VoterConfig voter_config, CommonConfig common_config);
   void run();
   std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock>
-  HandleKeyExchange(CryptoPP::RSA::PublicKey verification_key);
+  HandleKeyExchange(const RSAVerifierHandle &verifier, SessionTicket &ticket);
   void HandleRegister(std::string input);
   void HandleVote(std::string input);
   void HandleVerify(std::string input);
+  void HandlePrecompute(std::string input);
 //   std::tuple<CryptoPP::Integer, CryptoPP::Integer, bool> DoVerify();
   std::pair<bool, std::vector<CryptoPP::Integer>> DoVerify();
 private:
@@ -55,6 +56,10 @@ private:
   CryptoPP::RSA::PrivateKey RSA_voter_signing_key;
   CryptoPP::RSA::PublicKey RSA_registrar_verification_key;
   CryptoPP::RSA::PublicKey RSA_tallyer_verification_key;
+  std::shared_ptr<RSAVerifierHandle> RSA_registrar_verifier;
+  std::shared_ptr<RSAVerifierHandle> RSA_tallyer_verifier;
+  SessionTicket registrar_ticket; // resumes the next registrar session
+  SessionTicket tallyer_ticket;   // resumes the next tallyer session
 
   //add for final projects
   int t; // t candidates 
@@ -41,6 +41,14 @@ CommonConfig load_common_config(std::string filename) {
       root.get<std::string>("registrar_verification_key_path", "");
   config.tallyer_verification_key_path =
       root.get<std::string>("tallyer_verification_key_path", "");
+  config.dlog_table_path = root.get<std::string>("dlog_table_path", "");
+  config.group = root.get<std::string>("group", "");
+  config.min_votes = root.get<int>("min_votes", 0);
+  config.max_votes = root.get<int>("max_votes", 0);
+  config.compact_proofs = root.get<bool>("compact_proofs", false);
+  config.aead_channel = root.get<bool>("aead_channel", false);
+  config.session_ticket_lifetime =
+      root.get<int>("session_ticket_lifetime", 0);
 
   return config;
 }
@@ -65,6 +73,9 @@ VoterConfig load_voter_config(std::string filename) {
       root.get<std::string>("voter_registrar_signature_path", "");
   config.voter_blind_path = root.get<std::string>("voter_blind_path", "");
   config.voter_number_path = root.get<std::string>("voter_number_path", "");
+  config.voter_precompute_path =
+      root.get<std::string>("voter_precompute_path", "");
+  config.voter_precompute_size = root.get<int>("voter_precompute_size", 0);
 
   return config;
 }
@@ -84,6 +95,8 @@ RegistrarConfig load_registrar_config(std::string filename) {
   RegistrarConfig config;
   config.registrar_signing_key_path =
       root.get<std::string>("registrar_signing_key_path", "");
+  config.dh_pool_size = root.get<int>("dh_pool_size", 0);
+  config.dh_pool_refill_ms = root.get<int>("dh_pool_refill_ms", 0);
 
   return config;
 }
@@ -103,6 +116,8 @@ TallyerConfig load_tallyer_config(std::string filename) {
   TallyerConfig config;
   config.tallyer_signing_key_path =
       root.get<std::string>("tallyer_signing_key_path", "");
+  config.dh_pool_size = root.get<int>("dh_pool_size", 0);
+  config.dh_pool_refill_ms = root.get<int>("dh_pool_refill_ms", 0);
 
   return config;
 }
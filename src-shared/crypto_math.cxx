@@ -0,0 +1,546 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+#include <crypto++/nbtheory.h>
+
+#include "../include-shared/crypto_math.hpp"
+
+namespace {
+/**
+ * Pick the window width that minimizes table size plus window multiplications
+ * for an exponent of the given bit length.
+ */
+unsigned int window_width(unsigned int bits) {
+  unsigned int best = 1;
+  size_t best_cost = bits;
+  for (unsigned int w = 2; w <= 6; w++) {
+    size_t cost = ((size_t(1) << w) - 2) + (bits + w - 1) / w;
+    if (cost < best_cost) {
+      best = w;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
+
+// Multi-buffer Montgomery kernel. Lane values are stored limb-major: limb j
+// of lane l lives at [j * MODEXP_LANES + l], so every step of the limb loops
+// touches one contiguous run of MODEXP_LANES words. Limbs are 28 bits wide in
+// 64-bit words; products fit 56 bits, which leaves room to add up a full
+// column of them before propagating carries.
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define MODEXP_TARGET_CLONES                                                   \
+  __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef MODEXP_TARGET_CLONES
+#define MODEXP_TARGET_CLONES
+#endif
+
+const unsigned int LIMB_BITS = 28;
+const uint64_t LIMB_MASK = (uint64_t(1) << LIMB_BITS) - 1;
+// A column holds at most 2n products below 2^56, so n must stay under 128.
+const size_t MAX_LANE_LIMBS = 120;
+// Window tables hold 2^w entries per lane; past 5 bits they leave the cache.
+const unsigned int MAX_LANE_WINDOW = 5;
+
+/**
+ * Product of the low 32 bits of x and y, written so that it maps onto the
+ * 32x32->64 vector multiply.
+ */
+inline uint64_t mul32(uint64_t x, uint64_t y) {
+  return uint64_t(uint32_t(x)) * uint32_t(y);
+}
+
+// Modulus m with n limbs and R = 2^(28 n) > 4m, so products of inputs below
+// 2m stay below 2m and no multiplication needs a final subtraction.
+struct LaneModulus {
+  size_t n;
+  std::vector<uint64_t> m;
+  uint64_t m_inv;            // -m^-1 mod 2^28
+  std::vector<uint64_t> r2;  // R^2 mod m in every lane
+  std::vector<uint64_t> one; // 1 in every lane
+};
+
+/**
+ * out = a b R^-1 (mod m) for every lane, with out < 2m. Operand scanning
+ * with one combined pass per limb of b: t[i..] += a b[i] + q m, where q
+ * clears the low limb, whose carry is then pushed one column up. out must
+ * not overlap a, b or t; a and b may be the same.
+ */
+MODEXP_TARGET_CLONES
+void lanes_mont_mul(uint64_t *__restrict out, const uint64_t *a,
+                    const uint64_t *b, const uint64_t *__restrict m,
+                    uint64_t m_inv, size_t n, uint64_t *__restrict t) {
+  const size_t L = MODEXP_LANES;
+  std::fill(t, t + (2 * n + 1) * L, 0);
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t *bi = b + i * L;
+    uint64_t *ti = t + i * L;
+    uint64_t q[L];
+    for (size_t l = 0; l < L; l++) {
+      uint64_t low = (ti[l] + mul32(a[l], bi[l])) & LIMB_MASK;
+      q[l] = mul32(low, m_inv) & LIMB_MASK;
+    }
+    for (size_t j = 0; j < n; j++) {
+      const uint64_t *aj = a + j * L;
+      uint64_t *tij = ti + j * L;
+      uint64_t mj = m[j];
+      for (size_t l = 0; l < L; l++) {
+        tij[l] += mul32(aj[l], bi[l]) + mul32(q[l], mj);
+      }
+    }
+    for (size_t l = 0; l < L; l++) {
+      ti[L + l] += ti[l] >> LIMB_BITS;
+    }
+  }
+
+  // The result is the upper n columns; bring them back to 28-bit limbs.
+  uint64_t *hi = t + n * L;
+  for (size_t j = 0; j < n; j++) {
+    for (size_t l = 0; l < L; l++) {
+      hi[(j + 1) * L + l] += hi[j * L + l] >> LIMB_BITS;
+      out[j * L + l] = hi[j * L + l] & LIMB_MASK;
+    }
+  }
+}
+
+/**
+ * Raise every lane of values (plain residues) to its exponent in place.
+ * digits[k * MODEXP_LANES + l] is window k of lane l's exponent, windows of
+ * window_bits bits counted from the least significant end.
+ */
+void lanes_exponentiate(const LaneModulus &mod, std::vector<uint64_t> &values,
+                        const std::vector<uint8_t> &digits, size_t windows,
+                        unsigned int window_bits) {
+  const size_t L = MODEXP_LANES;
+  size_t n = mod.n;
+  size_t block = n * L;
+  size_t row = size_t(1) << window_bits;
+  std::vector<uint64_t> table(row * block);
+  std::vector<uint64_t> acc(block), tmp(block), factor(block);
+  std::vector<uint64_t> scratch((2 * n + 1) * L);
+  auto mul = [&](uint64_t *out, const uint64_t *a, const uint64_t *b) {
+    lanes_mont_mul(out, a, b, mod.m.data(), mod.m_inv, n, scratch.data());
+  };
+
+  // table[k] = x^k R for k in [0, 2^w).
+  mul(table.data(), mod.one.data(), mod.r2.data());
+  mul(table.data() + block, values.data(), mod.r2.data());
+  for (size_t k = 2; k < row; k++) {
+    mul(table.data() + k * block, table.data() + (k - 1) * block,
+        table.data() + block);
+  }
+
+  // Walk the windows from the top; every lane squares in lock step and
+  // multiplies in its own table entry.
+  std::copy(table.begin(), table.begin() + block, acc.begin());
+  for (size_t k = windows; k-- > 0;) {
+    if (k + 1 != windows) {
+      for (unsigned int s = 0; s < window_bits; s++) {
+        mul(tmp.data(), acc.data(), acc.data());
+        std::swap(acc, tmp);
+      }
+    }
+    for (size_t l = 0; l < L; l++) {
+      const uint64_t *entry = table.data() + digits[k * L + l] * block;
+      for (size_t j = 0; j < n; j++) {
+        factor[j * L + l] = entry[j * L + l];
+      }
+    }
+    mul(tmp.data(), acc.data(), factor.data());
+    std::swap(acc, tmp);
+  }
+  mul(values.data(), acc.data(), mod.one.data());
+}
+
+/**
+ * Whether this CPU has the AVX2 instructions the lane kernel is built
+ * around.
+ */
+bool lanes_supported() {
+#if defined(__x86_64__) && defined(__GNUC__)
+  static const bool supported = __builtin_cpu_supports("avx2");
+  return supported;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Lane layout of modulus, or n = 0 if it is too large for the kernel.
+ */
+LaneModulus lane_modulus(const CryptoPP::Integer &modulus) {
+  LaneModulus mod;
+  mod.n = (modulus.BitCount() + 2 + LIMB_BITS - 1) / LIMB_BITS;
+  if (mod.n > MAX_LANE_LIMBS) {
+    mod.n = 0;
+    return mod;
+  }
+  mod.m.resize(mod.n);
+  for (size_t j = 0; j < mod.n; j++) {
+    mod.m[j] = modulus.GetBits(j * LIMB_BITS, LIMB_BITS);
+  }
+  // Newton's iteration doubles the correct low bits of m^-1 each round.
+  uint32_t inv = uint32_t(mod.m[0]);
+  for (int i = 0; i < 5; i++) {
+    inv *= 2 - uint32_t(mod.m[0]) * inv;
+  }
+  mod.m_inv = (0 - uint64_t(inv)) & LIMB_MASK;
+
+  CryptoPP::Integer r2 =
+      CryptoPP::Integer::Power2(2 * LIMB_BITS * mod.n) % modulus;
+  mod.r2.assign(mod.n * MODEXP_LANES, 0);
+  mod.one.assign(mod.n * MODEXP_LANES, 0);
+  for (size_t l = 0; l < MODEXP_LANES; l++) {
+    for (size_t j = 0; j < mod.n; j++) {
+      mod.r2[j * MODEXP_LANES + l] = r2.GetBits(j * LIMB_BITS, LIMB_BITS);
+    }
+    mod.one[l] = 1;
+  }
+  return mod;
+}
+
+// Ids for MontgomeryContext, never reused, so a thread's workspace for one
+// context is never picked up by a later one.
+std::atomic<uint64_t> next_context_id(0);
+
+// A thread's copy of one context's workspace, kept while the context lives.
+struct ContextWorkspace {
+  std::weak_ptr<const void> owner;
+  std::unique_ptr<CryptoPP::MontgomeryRepresentation> workspace;
+};
+} // namespace
+
+// ================================================
+// FIXED-BASE EXPONENTIATION
+// ================================================
+
+/**
+ * Build the window table. Row i holds base^(j * 2^(w*i)) for j in [0, 2^w).
+ */
+FixedBaseTable::FixedBaseTable(const CryptoPP::Integer &base,
+                               const CryptoPP::Integer &modulus,
+                               const CryptoPP::Integer &order,
+                               unsigned int window_bits)
+    : base(base), order(order), mr(modulus), window_bits(window_bits) {
+  this->windows = (order.BitCount() + window_bits - 1) / window_bits;
+  size_t row = size_t(1) << window_bits;
+  this->table.resize(this->windows * row);
+
+  CryptoPP::Integer g = this->mr.ConvertIn(base % modulus);
+  for (unsigned int i = 0; i < this->windows; i++) {
+    CryptoPP::Integer *entries = &this->table[i * row];
+    entries[0] = this->mr.MultiplicativeIdentity();
+    entries[1] = g;
+    for (size_t j = 2; j < row; j++) {
+      entries[j] = this->mr.Multiply(entries[j - 1], g);
+    }
+    // Move on to base^(2^(w*(i+1))).
+    g = this->mr.Multiply(entries[row - 1], g);
+  }
+}
+
+/**
+ * Compute base^exponent mod modulus using the precomputed windows.
+ */
+CryptoPP::Integer
+FixedBaseTable::Exponentiate(const CryptoPP::Integer &exponent) const {
+  // The base has order `order`, so exponents can be reduced first.
+  CryptoPP::Integer e = exponent;
+  if (e.IsNegative() || e >= this->order) {
+    e = e % this->order;
+  }
+
+  // MontgomeryRepresentation keeps a mutable workspace; use a private copy so
+  // the table can be shared between connection threads.
+  CryptoPP::MontgomeryRepresentation mr(this->mr);
+  size_t row = size_t(1) << this->window_bits;
+  unsigned int used = (e.BitCount() + this->window_bits - 1) / this->window_bits;
+
+  CryptoPP::Integer result = mr.MultiplicativeIdentity();
+  for (unsigned int i = 0; i < used; i++) {
+    CryptoPP::lword digit = e.GetBits(i * this->window_bits, this->window_bits);
+    if (digit != 0) {
+      result = mr.Multiply(result, this->table[i * row + digit]);
+    }
+  }
+  return mr.ConvertOut(result);
+}
+
+/**
+ * Get the base this table was built for.
+ */
+const CryptoPP::Integer &FixedBaseTable::GetBase() const { return this->base; }
+
+// ================================================
+// MULTI-EXPONENTIATION
+// ================================================
+
+/**
+ * Simultaneous multi-exponentiation. Each base gets a table of its first 2^w
+ * powers; the bits of all exponents are then walked from the top, squaring
+ * once per bit and multiplying in every window that starts at that bit.
+ */
+CryptoPP::Integer
+MultiExponentiate(const std::vector<CryptoPP::Integer> &bases,
+                  const std::vector<CryptoPP::Integer> &exponents,
+                  const CryptoPP::Integer &modulus) {
+  assert(bases.size() == exponents.size());
+  CryptoPP::MontgomeryRepresentation mr(modulus);
+
+  // Build per-base window tables.
+  size_t n = bases.size();
+  std::vector<unsigned int> widths(n, 0);
+  std::vector<std::vector<CryptoPP::Integer>> tables(n);
+  unsigned int max_bits = 0;
+  for (size_t i = 0; i < n; i++) {
+    assert(exponents[i].NotNegative());
+    unsigned int bits = exponents[i].BitCount();
+    if (bits == 0) {
+      continue;
+    }
+    max_bits = std::max(max_bits, bits);
+    widths[i] = window_width(bits);
+
+    std::vector<CryptoPP::Integer> &table = tables[i];
+    table.resize(size_t(1) << widths[i]);
+    table[1] = mr.ConvertIn(bases[i] % modulus);
+    for (size_t j = 2; j < table.size(); j++) {
+      table[j] = mr.Multiply(table[j - 1], table[1]);
+    }
+  }
+
+  // Walk the exponent bits from the top.
+  CryptoPP::Integer result = mr.MultiplicativeIdentity();
+  bool started = false;
+  for (unsigned int bit = max_bits; bit-- > 0;) {
+    if (started) {
+      result = mr.Square(result);
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (widths[i] == 0 || bit % widths[i] != 0) {
+        continue;
+      }
+      CryptoPP::lword digit = exponents[i].GetBits(bit, widths[i]);
+      if (digit != 0) {
+        result = mr.Multiply(result, tables[i][digit]);
+        started = true;
+      }
+    }
+  }
+  return mr.ConvertOut(result);
+}
+
+// ================================================
+// BATCHED INVERSION
+// ================================================
+
+/**
+ * Montgomery's trick: form the prefix products x0 ... xi, invert the full
+ * product once, then peel the inverses off from the back.
+ */
+std::vector<CryptoPP::Integer>
+BatchInverse(const std::vector<CryptoPP::Integer> &xs,
+             const CryptoPP::Integer &modulus) {
+  size_t n = xs.size();
+  std::vector<CryptoPP::Integer> inverses(n);
+  if (n == 0) {
+    return inverses;
+  }
+  CryptoPP::MontgomeryRepresentation mr(modulus);
+
+  std::vector<CryptoPP::Integer> elements(n);
+  std::vector<CryptoPP::Integer> prefix(n);
+  for (size_t i = 0; i < n; i++) {
+    elements[i] = mr.ConvertIn(xs[i] % modulus);
+    prefix[i] = i == 0 ? elements[0] : mr.Multiply(prefix[i - 1], elements[i]);
+  }
+
+  CryptoPP::Integer total =
+      CryptoPP::EuclideanMultiplicativeInverse(mr.ConvertOut(prefix[n - 1]),
+                                               modulus);
+  if (total.IsZero()) {
+    throw std::invalid_argument("batch inverse of a non-invertible element");
+  }
+  CryptoPP::Integer inverse = mr.ConvertIn(total);
+  for (size_t i = n - 1; i > 0; i--) {
+    inverses[i] = mr.ConvertOut(mr.Multiply(inverse, prefix[i - 1]));
+    inverse = mr.Multiply(inverse, elements[i]);
+  }
+  inverses[0] = mr.ConvertOut(inverse);
+  return inverses;
+}
+
+// ================================================
+// MULTI-BUFFER EXPONENTIATION
+// ================================================
+
+/**
+ * Fill MODEXP_LANES lanes at a time and run them through the lane kernel;
+ * unused lanes of the last block compute 1^0. Falls back to one Crypto++
+ * exponentiation per value on CPUs without AVX2 and for oversized moduli.
+ */
+std::vector<CryptoPP::Integer>
+BatchExponentiate(const std::vector<CryptoPP::Integer> &bases,
+                  const std::vector<CryptoPP::Integer> &exponents,
+                  const CryptoPP::Integer &modulus) {
+  assert(bases.size() == exponents.size());
+  assert(modulus.IsOdd());
+  size_t count = bases.size();
+  std::vector<CryptoPP::Integer> results(count);
+  LaneModulus mod;
+  mod.n = 0;
+  if (count > 1 && lanes_supported()) {
+    mod = lane_modulus(modulus);
+  }
+  if (mod.n == 0) {
+    for (size_t i = 0; i < count; i++) {
+      results[i] = CryptoPP::ModularExponentiation(bases[i], exponents[i],
+                                                   modulus);
+    }
+    return results;
+  }
+
+  const size_t L = MODEXP_LANES;
+  std::vector<uint64_t> values(mod.n * L);
+  std::vector<uint8_t> digits;
+  for (size_t start = 0; start < count; start += L) {
+    size_t lanes = std::min(L, count - start);
+    unsigned int max_bits = 0;
+    for (size_t l = 0; l < lanes; l++) {
+      assert(exponents[start + l].NotNegative());
+      max_bits = std::max(max_bits, exponents[start + l].BitCount());
+    }
+    unsigned int w = std::min(window_width(max_bits), MAX_LANE_WINDOW);
+    size_t windows = std::max<size_t>(1, (max_bits + w - 1) / w);
+
+    digits.assign(windows * L, 0);
+    for (size_t l = 0; l < L; l++) {
+      CryptoPP::Integer x = CryptoPP::Integer::One();
+      if (l < lanes) {
+        x = bases[start + l] % modulus;
+        for (size_t k = 0; k < windows; k++) {
+          digits[k * L + l] = exponents[start + l].GetBits(k * w, w);
+        }
+      }
+      for (size_t j = 0; j < mod.n; j++) {
+        values[j * L + l] = x.GetBits(j * LIMB_BITS, LIMB_BITS);
+      }
+    }
+
+    lanes_exponentiate(mod, values, digits, windows, w);
+
+    for (size_t l = 0; l < lanes; l++) {
+      CryptoPP::Integer x = CryptoPP::Integer::Zero();
+      for (size_t j = mod.n; j-- > 0;) {
+        x <<= LIMB_BITS;
+        x += CryptoPP::Integer(CryptoPP::Integer::POSITIVE,
+                               values[j * L + l]);
+      }
+      results[start + l] = x % modulus;
+    }
+  }
+  return results;
+}
+
+// ================================================
+// MONTGOMERY ARITHMETIC
+// ================================================
+
+MontgomeryContext::MontgomeryContext(const CryptoPP::Integer &modulus)
+    : modulus(modulus), prototype(modulus), id(next_context_id++),
+      lifetime(std::make_shared<const char>()) {
+  this->r = this->prototype.ConvertIn(CryptoPP::Integer::One());
+}
+
+const CryptoPP::Integer &MontgomeryContext::GetModulus() const {
+  return this->modulus;
+}
+
+const CryptoPP::Integer &MontgomeryContext::GetR() const { return this->r; }
+
+CryptoPP::Integer
+MontgomeryContext::ConvertIn(const CryptoPP::Integer &x) const {
+  return this->Workspace().ConvertIn(x % this->modulus);
+}
+
+CryptoPP::Integer
+MontgomeryContext::ConvertOut(const CryptoPP::Integer &x) const {
+  return this->Workspace().ConvertOut(x);
+}
+
+CryptoPP::Integer MontgomeryContext::Multiply(const CryptoPP::Integer &x,
+                                              const CryptoPP::Integer &y) const {
+  return this->Workspace().Multiply(x, y);
+}
+
+CryptoPP::Integer MontgomeryContext::Square(const CryptoPP::Integer &x) const {
+  return this->Workspace().Square(x);
+}
+
+/**
+ * MontgomeryRepresentation keeps a mutable workspace, so every thread gets
+ * its own copy. Copies are keyed by context id; those of destroyed contexts
+ * are dropped the next time the thread makes a new copy.
+ */
+const CryptoPP::MontgomeryRepresentation &
+MontgomeryContext::Workspace() const {
+  thread_local std::unordered_map<uint64_t, ContextWorkspace> workspaces;
+  auto it = workspaces.find(this->id);
+  if (it != workspaces.end()) {
+    return *it->second.workspace;
+  }
+  std::erase_if(workspaces,
+                [](const auto &entry) { return entry.second.owner.expired(); });
+  ContextWorkspace &entry = workspaces[this->id];
+  entry.owner = this->lifetime;
+  entry.workspace =
+      std::make_unique<CryptoPP::MontgomeryRepresentation>(this->prototype);
+  return *entry.workspace;
+}
+
+MontgomeryProduct::MontgomeryProduct(
+    std::shared_ptr<const MontgomeryContext> context)
+    : context(context), value(CryptoPP::Integer::One()), debt(0) {}
+
+/**
+ * Multiply in a residue x (reduced first if it is out of range).
+ */
+void MontgomeryProduct::Multiply(const CryptoPP::Integer &x) {
+  const CryptoPP::Integer &m = this->context->GetModulus();
+  if (x.IsNegative() || x >= m) {
+    this->value = this->context->Multiply(this->value, x % m);
+  } else {
+    this->value = this->context->Multiply(this->value, x);
+  }
+  this->debt++;
+}
+
+/**
+ * Multiply in another product over the same context.
+ */
+void MontgomeryProduct::Multiply(const MontgomeryProduct &other) {
+  this->value = this->context->Multiply(this->value, other.value);
+  this->debt += other.debt + 1;
+}
+
+/**
+ * The product as a plain residue: value * R^debt mod m.
+ */
+CryptoPP::Integer MontgomeryProduct::Value() const {
+  const CryptoPP::Integer &m = this->context->GetModulus();
+  if (this->debt == 0) {
+    return this->value % m;
+  }
+  CryptoPP::Integer r_debt = CryptoPP::ModularExponentiation(
+      this->context->GetR(), CryptoPP::Integer(CryptoPP::Integer::POSITIVE,
+                                               this->debt),
+      m);
+  return CryptoPP::a_times_b_mod_c(this->value, r_debt, m);
+}
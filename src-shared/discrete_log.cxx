@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include "../include-shared/discrete_log.hpp"
+
+namespace {
+const char TABLE_MAGIC[8] = {'D', 'L', 'O', 'G', 'T', 'B', 'L', '\0'};
+const uint64_t TABLE_VERSION = 2;
+
+/**
+ * Low 64 bits of an element encoding; used to index the baby steps.
+ */
+uint64_t fingerprint(const CryptoPP::Integer &x) { return x.GetBits(0, 64); }
+
+/**
+ * FNV-1a of the group name, so tables of different groups never match.
+ */
+uint64_t name_fingerprint(const std::string &name) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : name) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool entry_less(const DiscreteLogTable::Entry &lhs,
+                const DiscreteLogTable::Entry &rhs) {
+  return lhs.fingerprint < rhs.fingerprint;
+}
+} // namespace
+
+/**
+ * Shared setup for building and loading.
+ */
+DiscreteLogTable::DiscreteLogTable(std::shared_ptr<const Group> group)
+    : group(group), baby_steps(0), entries(nullptr) {}
+
+/**
+ * Build the baby steps g^0 .. g^(baby_steps - 1) in memory.
+ */
+DiscreteLogTable::DiscreteLogTable(std::shared_ptr<const Group> group,
+                                   uint64_t baby_steps)
+    : DiscreteLogTable(group) {
+  this->baby_steps = baby_steps;
+  this->owned.resize(baby_steps);
+
+  const CryptoPP::Integer &g = group->Generator();
+  CryptoPP::Integer x = group->Identity();
+  for (uint64_t j = 0; j < baby_steps; j++) {
+    this->owned[j] = Entry{fingerprint(x), j};
+    x = group->Mul(x, g);
+  }
+  std::sort(this->owned.begin(), this->owned.end(), entry_less);
+  this->entries = this->owned.data();
+}
+
+/**
+ * Memory-map a table previously written with Save. Throws if the file is
+ * truncated or was built for a different group.
+ */
+std::shared_ptr<DiscreteLogTable>
+DiscreteLogTable::Load(const std::string &filename,
+                       std::shared_ptr<const Group> group) {
+  std::shared_ptr<DiscreteLogTable> table(new DiscreteLogTable(group));
+  table->file = boost::interprocess::file_mapping(
+      filename.c_str(), boost::interprocess::read_only);
+  table->region = boost::interprocess::mapped_region(
+      table->file, boost::interprocess::read_only);
+
+  size_t size = table->region.get_size();
+  if (size < sizeof(Header)) {
+    throw std::runtime_error("discrete log table is truncated");
+  }
+  Header header;
+  std::memcpy(&header, table->region.get_address(), sizeof(Header));
+  Header expected = table->MakeHeader();
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+      header.version != expected.version ||
+      header.group_fingerprint != expected.group_fingerprint ||
+      header.generator_fingerprint != expected.generator_fingerprint) {
+    throw std::runtime_error("discrete log table is for a different group");
+  }
+  // Divide rather than multiply: a forged step count must not wrap around.
+  size_t body = size - sizeof(Header);
+  if (body % sizeof(Entry) != 0 ||
+      header.baby_steps != body / sizeof(Entry)) {
+    throw std::runtime_error("discrete log table is truncated");
+  }
+
+  table->baby_steps = header.baby_steps;
+  table->entries = reinterpret_cast<const Entry *>(
+      static_cast<const char *>(table->region.get_address()) + sizeof(Header));
+  return table;
+}
+
+/**
+ * Write the table to the file so it can be mapped with Load. The table is
+ * written next to the file and renamed over it, so a concurrent Load sees
+ * either the old table or the whole new one.
+ */
+void DiscreteLogTable::Save(const std::string &filename) const {
+  std::string partial = filename + ".tmp." + std::to_string(getpid());
+  std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("could not open " + partial);
+  }
+  Header header = this->MakeHeader();
+  header.baby_steps = this->baby_steps;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+  out.write(reinterpret_cast<const char *>(this->entries),
+            this->baby_steps * sizeof(Entry));
+  out.close();
+  if (!out || std::rename(partial.c_str(), filename.c_str()) != 0) {
+    std::remove(partial.c_str());
+    throw std::runtime_error("could not write " + filename);
+  }
+}
+
+/**
+ * Find exponent in [0, max_exponent) with g^exponent = target. Walks
+ * target * g^(-m*i) for i = 0, 1, ... and looks each value up in the
+ * baby steps; fingerprint hits are confirmed with a full exponentiation.
+ * Returns false if there is no such exponent.
+ */
+bool DiscreteLogTable::Solve(const CryptoPP::Integer &target,
+                             uint64_t max_exponent,
+                             CryptoPP::Integer &exponent) const {
+  if (this->baby_steps == 0 || !this->group->IsElement(target)) {
+    return false;
+  }
+  const Group &group = *this->group;
+  CryptoPP::Integer m(static_cast<long>(this->baby_steps));
+  CryptoPP::Integer giant_step =
+      group.ExpGenerator((group.Order() - m % group.Order()) % group.Order());
+
+  CryptoPP::Integer y = target;
+  uint64_t giant_steps = (max_exponent + this->baby_steps - 1) / this->baby_steps;
+  for (uint64_t i = 0; i < giant_steps; i++) {
+    Entry key{fingerprint(y), 0};
+    auto range = std::equal_range(this->entries,
+                                  this->entries + this->baby_steps, key,
+                                  entry_less);
+    for (auto it = range.first; it != range.second; it++) {
+      uint64_t candidate = i * this->baby_steps + it->exponent;
+      CryptoPP::Integer e(static_cast<long>(candidate));
+      if (candidate < max_exponent && group.ExpGenerator(e) == target) {
+        exponent = e;
+        return true;
+      }
+    }
+    y = group.Mul(y, giant_step);
+  }
+  return false;
+}
+
+/**
+ * Number of baby steps in the table.
+ */
+uint64_t DiscreteLogTable::GetBabySteps() const { return this->baby_steps; }
+
+/**
+ * Header identifying the format and the group this table belongs to.
+ */
+DiscreteLogTable::Header DiscreteLogTable::MakeHeader() const {
+  Header header;
+  std::memcpy(header.magic, TABLE_MAGIC, sizeof(header.magic));
+  header.version = TABLE_VERSION;
+  header.baby_steps = 0;
+  header.group_fingerprint = name_fingerprint(this->group->Name());
+  header.generator_fingerprint = fingerprint(this->group->Generator());
+  return header;
+}
@@ -0,0 +1,427 @@
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <crypto++/nbtheory.h>
+
+#include "../include-shared/constants.hpp"
+#include "../include-shared/group.hpp"
+
+namespace {
+// Every group SetElectionGroup installs stays alive until exit, so
+// ElectionGroup can hand out the current one without taking a lock.
+std::mutex election_group_mtx; // serializes installs
+std::deque<std::shared_ptr<const Group>> election_groups;
+std::atomic<const std::shared_ptr<const Group> *> election_group(nullptr);
+std::once_flag election_group_default;
+
+/**
+ * Make name's group the election group. Callers hold election_group_mtx.
+ */
+void install_election_group(const std::string &name) {
+  election_groups.push_back(MakeGroup(name));
+  election_group.store(&election_groups.back(), std::memory_order_release);
+}
+
+std::atomic<uint64_t> next_group_id(0);
+
+// A thread's copy of one curve group's ECP, kept while the group lives.
+struct CurveCopy {
+  std::weak_ptr<const void> owner;
+  std::unique_ptr<CryptoPP::ECP> curve;
+};
+
+/**
+ * Accumulator that multiplies with Group::Mul.
+ */
+class MulAccumulator : public GroupAccumulator {
+public:
+  explicit MulAccumulator(const Group &group)
+      : group(group), value(group.Identity()) {}
+  void Mul(const CryptoPP::Integer &x) override {
+    this->value = this->group.Mul(this->value, x);
+  }
+  void Mul(const GroupAccumulator &other) override {
+    this->value = this->group.Mul(this->value, other.Value());
+  }
+  CryptoPP::Integer Value() const override { return this->value; }
+
+private:
+  const Group &group;
+  CryptoPP::Integer value;
+};
+
+/**
+ * Accumulator that keeps a MODP product in Montgomery form.
+ */
+class MontgomeryAccumulator : public GroupAccumulator {
+public:
+  explicit MontgomeryAccumulator(
+      std::shared_ptr<const MontgomeryContext> context)
+      : product(context) {}
+  void Mul(const CryptoPP::Integer &x) override { this->product.Multiply(x); }
+  void Mul(const GroupAccumulator &other) override {
+    this->product.Multiply(
+        static_cast<const MontgomeryAccumulator &>(other).product);
+  }
+  CryptoPP::Integer Value() const override { return this->product.Value(); }
+
+private:
+  MontgomeryProduct product;
+};
+} // namespace
+
+// ================================================
+// GROUP
+// ================================================
+
+/**
+ * Encode an element as ElementSize() big-endian bytes.
+ */
+std::vector<unsigned char>
+Group::ElementToBytes(const CryptoPP::Integer &x) const {
+  std::vector<unsigned char> data(this->ElementSize());
+  x.Encode(data.data(), data.size());
+  return data;
+}
+
+/**
+ * Decode an element written by ElementToBytes.
+ */
+CryptoPP::Integer
+Group::ElementFromBytes(const std::vector<unsigned char> &data) const {
+  return CryptoPP::Integer(data.data(), data.size());
+}
+
+/**
+ * Raise the generator to e.
+ */
+CryptoPP::Integer Group::ExpGenerator(const CryptoPP::Integer &e) const {
+  return this->Exp(this->Generator(), e);
+}
+
+std::vector<CryptoPP::Integer>
+Group::BatchInverse(const std::vector<CryptoPP::Integer> &xs) const {
+  std::vector<CryptoPP::Integer> inverses;
+  inverses.reserve(xs.size());
+  for (const CryptoPP::Integer &x : xs) {
+    inverses.push_back(this->Inverse(x));
+  }
+  return inverses;
+}
+
+std::vector<CryptoPP::Integer>
+Group::BatchExp(const std::vector<CryptoPP::Integer> &bases,
+                const std::vector<CryptoPP::Integer> &exponents) const {
+  std::vector<CryptoPP::Integer> powers;
+  powers.reserve(bases.size());
+  for (size_t i = 0; i < bases.size(); i++) {
+    powers.push_back(this->Exp(bases[i], exponents[i]));
+  }
+  return powers;
+}
+
+CryptoPP::Integer Group::GeneratorInverse() const {
+  return this->Inverse(this->Generator());
+}
+
+std::unique_ptr<GroupAccumulator> Group::NewAccumulator() const {
+  return std::make_unique<MulAccumulator>(*this);
+}
+
+// ================================================
+// MODP GROUP
+// ================================================
+
+ModPGroup::ModPGroup(const std::string &name, const CryptoPP::Integer &p,
+                     const CryptoPP::Integer &q, const CryptoPP::Integer &g)
+    : name(name), p(p), q(q), g(g),
+      g_inv(CryptoPP::EuclideanMultiplicativeInverse(g, p)),
+      g_table(g, p, q),
+      p_context(std::make_shared<const MontgomeryContext>(p)) {}
+
+std::string ModPGroup::Name() const { return this->name; }
+
+const CryptoPP::Integer &ModPGroup::Order() const { return this->q; }
+
+const CryptoPP::Integer &ModPGroup::Generator() const { return this->g; }
+
+CryptoPP::Integer ModPGroup::Identity() const { return CryptoPP::Integer::One(); }
+
+/**
+ * Residues in [1, p) of order dividing q, i.e. x^q == 1.
+ */
+bool ModPGroup::IsElement(const CryptoPP::Integer &x) const {
+  return x.IsPositive() && x < this->p &&
+         CryptoPP::ModularExponentiation(x, this->q, this->p) ==
+             CryptoPP::Integer::One();
+}
+
+CryptoPP::Integer ModPGroup::Mul(const CryptoPP::Integer &x,
+                                 const CryptoPP::Integer &y) const {
+  return CryptoPP::a_times_b_mod_c(x, y, this->p);
+}
+
+CryptoPP::Integer ModPGroup::Inverse(const CryptoPP::Integer &x) const {
+  return CryptoPP::EuclideanMultiplicativeInverse(x, this->p);
+}
+
+std::vector<CryptoPP::Integer>
+ModPGroup::BatchInverse(const std::vector<CryptoPP::Integer> &xs) const {
+  return ::BatchInverse(xs, this->p);
+}
+
+CryptoPP::Integer ModPGroup::GeneratorInverse() const { return this->g_inv; }
+
+/**
+ * x^e mod p. Negative exponents are reduced mod q, which assumes x lies in
+ * the order-q subgroup.
+ */
+CryptoPP::Integer ModPGroup::Exp(const CryptoPP::Integer &x,
+                                 const CryptoPP::Integer &e) const {
+  if (x == this->g) {
+    return this->g_table.Exponentiate(e);
+  }
+  std::shared_ptr<const FixedBaseTable> table;
+  {
+    std::unique_lock<std::mutex> lck(this->base_mtx);
+    table = this->base_table;
+  }
+  if (table && table->GetBase() == x) {
+    return table->Exponentiate(e);
+  }
+  CryptoPP::Integer exponent = e.IsNegative() ? e % this->q : e;
+  return CryptoPP::ModularExponentiation(x, exponent, this->p);
+}
+
+CryptoPP::Integer
+ModPGroup::MultiExp(const std::vector<CryptoPP::Integer> &bases,
+                    const std::vector<CryptoPP::Integer> &exponents) const {
+  return MultiExponentiate(bases, exponents, this->p);
+}
+
+/**
+ * Powers of g and of the precomputed base come from their tables; all the
+ * others run side by side through BatchExponentiate. Negative exponents are
+ * reduced mod q as in Exp.
+ */
+std::vector<CryptoPP::Integer>
+ModPGroup::BatchExp(const std::vector<CryptoPP::Integer> &bases,
+                    const std::vector<CryptoPP::Integer> &exponents) const {
+  std::shared_ptr<const FixedBaseTable> table;
+  {
+    std::unique_lock<std::mutex> lck(this->base_mtx);
+    table = this->base_table;
+  }
+  std::vector<CryptoPP::Integer> powers(bases.size());
+  std::vector<size_t> rest;
+  std::vector<CryptoPP::Integer> rest_bases;
+  std::vector<CryptoPP::Integer> rest_exponents;
+  for (size_t i = 0; i < bases.size(); i++) {
+    if (bases[i] == this->g) {
+      powers[i] = this->g_table.Exponentiate(exponents[i]);
+    } else if (table && table->GetBase() == bases[i]) {
+      powers[i] = table->Exponentiate(exponents[i]);
+    } else {
+      rest.push_back(i);
+      rest_bases.push_back(bases[i]);
+      rest_exponents.push_back(exponents[i].IsNegative()
+                                   ? exponents[i] % this->q
+                                   : exponents[i]);
+    }
+  }
+  std::vector<CryptoPP::Integer> rest_powers =
+      BatchExponentiate(rest_bases, rest_exponents, this->p);
+  for (size_t k = 0; k < rest.size(); k++) {
+    powers[rest[k]] = rest_powers[k];
+  }
+  return powers;
+}
+
+/**
+ * Build a fixed-base table for x, replacing the previous one. The table is
+ * only rebuilt when x changes (e.g. after the arbiters regenerate).
+ */
+void ModPGroup::PrecomputeBase(const CryptoPP::Integer &x) const {
+  std::unique_lock<std::mutex> lck(this->base_mtx);
+  if (!this->base_table || this->base_table->GetBase() != x) {
+    this->base_table =
+        std::make_shared<const FixedBaseTable>(x, this->p, this->q);
+  }
+}
+
+size_t ModPGroup::ElementSize() const { return this->p.ByteCount(); }
+
+std::unique_ptr<GroupAccumulator> ModPGroup::NewAccumulator() const {
+  return std::make_unique<MontgomeryAccumulator>(this->p_context);
+}
+
+// ================================================
+// ELLIPTIC CURVE GROUP
+// ================================================
+
+ECGroup::ECGroup(const std::string &name, const CryptoPP::OID &curve)
+    : name(name), params(curve), id(next_group_id++),
+      lifetime(std::make_shared<const char>()) {
+  this->order = this->params.GetSubgroupOrder();
+  this->generator = this->Encode(this->params.GetSubgroupGenerator());
+}
+
+std::string ECGroup::Name() const { return this->name; }
+
+const CryptoPP::Integer &ECGroup::Order() const { return this->order; }
+
+const CryptoPP::Integer &ECGroup::Generator() const { return this->generator; }
+
+CryptoPP::Integer ECGroup::Identity() const { return CryptoPP::Integer::Zero(); }
+
+bool ECGroup::IsElement(const CryptoPP::Integer &x) const {
+  CryptoPP::ECP::Point point;
+  return this->Decode(x, point);
+}
+
+CryptoPP::Integer ECGroup::Mul(const CryptoPP::Integer &x,
+                               const CryptoPP::Integer &y) const {
+  return this->Encode(this->Curve().Add(this->Decode(x), this->Decode(y)));
+}
+
+CryptoPP::Integer ECGroup::Inverse(const CryptoPP::Integer &x) const {
+  return this->Encode(this->Curve().Inverse(this->Decode(x)));
+}
+
+CryptoPP::Integer ECGroup::Exp(const CryptoPP::Integer &x,
+                               const CryptoPP::Integer &e) const {
+  return this->Encode(
+      this->Curve().ScalarMultiply(this->Decode(x), e % this->order));
+}
+
+/**
+ * Pairs of terms go through ECP::CascadeScalarMultiply (Shamir's trick).
+ */
+CryptoPP::Integer
+ECGroup::MultiExp(const std::vector<CryptoPP::Integer> &bases,
+                  const std::vector<CryptoPP::Integer> &exponents) const {
+  const CryptoPP::ECP &curve = this->Curve();
+  CryptoPP::ECP::Point result = curve.Identity();
+  size_t i = 0;
+  for (; i + 1 < bases.size(); i += 2) {
+    result = curve.Add(
+        result, curve.CascadeScalarMultiply(
+                    this->Decode(bases[i]), exponents[i] % this->order,
+                    this->Decode(bases[i + 1]), exponents[i + 1] % this->order));
+  }
+  if (i < bases.size()) {
+    result = curve.Add(result, curve.ScalarMultiply(this->Decode(bases[i]),
+                                                    exponents[i] % this->order));
+  }
+  return this->Encode(result);
+}
+
+void ECGroup::PrecomputeBase(const CryptoPP::Integer &) const {}
+
+size_t ECGroup::ElementSize() const {
+  return this->params.GetCurve().EncodedPointSize(true);
+}
+
+/**
+ * ECP keeps a mutable workspace, so every thread gets its own copy. Copies
+ * are keyed by group id, as MontgomeryContext keys its workspaces; those of
+ * destroyed groups are dropped the next time the thread makes a new copy.
+ */
+const CryptoPP::ECP &ECGroup::Curve() const {
+  thread_local std::unordered_map<uint64_t, CurveCopy> curves;
+  auto it = curves.find(this->id);
+  if (it != curves.end()) {
+    return *it->second.curve;
+  }
+  std::erase_if(curves,
+                [](const auto &entry) { return entry.second.owner.expired(); });
+  CurveCopy &entry = curves[this->id];
+  entry.owner = this->lifetime;
+  entry.curve = std::make_unique<CryptoPP::ECP>(this->params.GetCurve());
+  return *entry.curve;
+}
+
+/**
+ * Decode a compressed point; 0 is the point at infinity.
+ */
+bool ECGroup::Decode(const CryptoPP::Integer &x,
+                     CryptoPP::ECP::Point &point) const {
+  if (x.IsZero()) {
+    point = this->Curve().Identity();
+    return true;
+  }
+  size_t size = this->ElementSize();
+  if (x.IsNegative() || x.ByteCount() != size) {
+    return false;
+  }
+  std::vector<unsigned char> data(size);
+  x.Encode(data.data(), size);
+  const CryptoPP::ECP &curve = this->Curve();
+  return curve.DecodePoint(point, data.data(), size) &&
+         curve.VerifyPoint(point);
+}
+
+CryptoPP::ECP::Point ECGroup::Decode(const CryptoPP::Integer &x) const {
+  CryptoPP::ECP::Point point;
+  if (!this->Decode(x, point)) {
+    throw std::invalid_argument("not a point on " + this->name);
+  }
+  return point;
+}
+
+CryptoPP::Integer ECGroup::Encode(const CryptoPP::ECP::Point &point) const {
+  if (point.identity) {
+    return CryptoPP::Integer::Zero();
+  }
+  size_t size = this->ElementSize();
+  std::vector<unsigned char> data(size);
+  this->Curve().EncodePoint(data.data(), point, true);
+  return CryptoPP::Integer(data.data(), size);
+}
+
+// ================================================
+// ELECTION GROUP
+// ================================================
+
+/**
+ * Construct the group with the given config name.
+ */
+std::shared_ptr<const Group> MakeGroup(const std::string &name) {
+  if (name.empty() || name == GROUP_MODP_2048) {
+    return std::make_shared<const ModPGroup>(GROUP_MODP_2048, DL_P, DL_Q, DL_G);
+  }
+  if (name == GROUP_SECP256R1) {
+    return std::make_shared<const ECGroup>(GROUP_SECP256R1,
+                                           CryptoPP::ASN1::secp256r1());
+  }
+  throw std::invalid_argument("unknown group: " + name);
+}
+
+/**
+ * Select the election group. Call before any election operation runs.
+ */
+void SetElectionGroup(const std::string &name) {
+  std::unique_lock<std::mutex> lck(election_group_mtx);
+  install_election_group(name);
+}
+
+/**
+ * Get the election group, installing the default one on first use.
+ */
+const std::shared_ptr<const Group> &ElectionGroup() {
+  const std::shared_ptr<const Group> *group =
+      election_group.load(std::memory_order_acquire);
+  if (!group) {
+    std::call_once(election_group_default, [] {
+      std::unique_lock<std::mutex> lck(election_group_mtx);
+      if (!election_group.load(std::memory_order_relaxed)) {
+        install_election_group(GROUP_MODP_2048);
+      }
+    });
+    group = election_group.load(std::memory_order_acquire);
+  }
+  return *group;
+}
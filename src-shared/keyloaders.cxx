@@ -1,5 +1,7 @@
 #include "../include-shared/keyloaders.hpp"
 #include "../include-shared/constants.hpp"
+#include "../include-shared/group.hpp"
+#include "../include-shared/rng.hpp"
 #include "../include-shared/util.hpp"
 
 /**
@@ -16,7 +18,7 @@ void SaveRSAPrivateKey(const std::string &filename,
 void LoadRSAPrivateKey(const std::string &filename, CryptoPP::PrivateKey &key) {
   key.Load(CryptoPP::FileStore(filename.c_str()).Ref());
 
-  CryptoPP::AutoSeededRandomPool rng;
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
   if (!key.Validate(rng, 3)) {
     throw std::runtime_error("RSA private key loading failed");
   }
@@ -81,7 +83,7 @@ void LoadVoteZKP(const std::string &filename, VoteZKP_Struct &vote_zkp) {
 void LoadRSAPublicKey(const std::string &filename, CryptoPP::PublicKey &key) {
   key.Load(CryptoPP::FileStore(filename.c_str()).Ref());
 
-  CryptoPP::AutoSeededRandomPool rng;
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
   if (!key.Validate(rng, 3)) {
     throw std::runtime_error("RSA public key loading failed");
   }
@@ -109,11 +111,12 @@ void LoadInteger(const std::string &filename, CryptoPP::Integer &i) {
  */
 void LoadElectionPublicKey(const std::vector<std::string> &filenames,
                            CryptoPP::Integer &public_key) {
-  CryptoPP::Integer final_key = CryptoPP::Integer::One();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  CryptoPP::Integer final_key = group->Identity();
   for (auto path : filenames) {
     CryptoPP::Integer key;
     LoadInteger(path, key);
-    final_key *= key;
+    final_key = group->Mul(final_key, key);
   }
   public_key = CryptoPP::Integer(final_key);
 }
@@ -1,14 +1,106 @@
+#include <algorithm>
+#include <cstring>
+
 #include "../include-shared/messages.hpp"
+#include "../include-shared/group.hpp"
 #include "../include-shared/util.hpp"
 
+namespace {
+// The wire version is the top byte of an integer's length word.
+const int WIRE_VERSION_SHIFT = 8 * (sizeof(size_t) - 1);
+const size_t WIRE_LENGTH_MASK = (size_t(1) << WIRE_VERSION_SHIFT) - 1;
+
+/**
+ * Puts i into the end of data as at least width big-endian bytes.
+ * Negative values have no binary form and are written in decimal.
+ */
+int put_integer_bytes(const CryptoPP::Integer &i, size_t width,
+                      std::vector<unsigned char> &data,
+                      WireVersion::T version) {
+  if (version == WireVersion::DECIMAL || i.IsNegative()) {
+    return put_string(CryptoPP::IntToString(i), data);
+  }
+  width = std::max(width, (size_t)i.ByteCount());
+  size_t header = ((size_t)WireVersion::BINARY << WIRE_VERSION_SHIFT) | width;
+  int idx = data.size();
+  data.resize(idx + sizeof(size_t) + width);
+  std::memcpy(&data[idx], &header, sizeof(size_t));
+  i.Encode(data.data() + idx + sizeof(size_t), width);
+  return data.size() - idx;
+}
+
+/**
+ * Number of bytes put_integer_bytes puts for i.
+ */
+size_t integer_bytes_size(const CryptoPP::Integer &i, size_t width,
+                          WireVersion::T version) {
+  if (version == WireVersion::DECIMAL || i.IsNegative()) {
+    return string_size(CryptoPP::IntToString(i).size());
+  }
+  return sizeof(size_t) + std::max(width, (size_t)i.ByteCount());
+}
+
+/**
+ * Puts the type byte and, in the counted form, the element count and a
+ * length word for end_container to fill in. Returns where the elements
+ * start.
+ */
+size_t begin_container(MessageType::T type, MessageType::T counted_type,
+                       bool counted, size_t count,
+                       std::vector<unsigned char> &data) {
+  data.push_back((char)(counted ? counted_type : type));
+  if (counted) {
+    int idx = data.size();
+    data.resize(idx + container_header_size());
+    std::memcpy(&data[idx], &count, sizeof(size_t));
+  }
+  return data.size();
+}
+
+/**
+ * Fills in the length of a counted container whose elements start at begin.
+ */
+void end_container(bool counted, size_t begin,
+                   std::vector<unsigned char> &data) {
+  if (counted) {
+    size_t length = data.size() - begin;
+    std::memcpy(&data[begin - sizeof(size_t)], &length, sizeof(size_t));
+  }
+}
+
+/**
+ * A container that is not the last field of its message must carry its own
+ * length, even if it was read in the uncounted form.
+ */
+void require_counted(Multi_Vote_Ciphertext &votes, Multi_VoteZKP_Struct &zkps,
+                     Multi_Integer &signatures) {
+  votes.counted = true;
+  zkps.counted = true;
+  signatures.counted = true;
+}
+
+/**
+ * Throws unless a counted container's elements were exactly count elements.
+ */
+void check_container(bool counted, size_t count, size_t found,
+                     const ByteReader &elements) {
+  if (counted && (found != count || !elements.AtEnd())) {
+    throw std::runtime_error("container length does not match its count");
+  }
+}
+} // namespace
+
 // ================================================
 // MESSAGE TYPES
 // ================================================
 
 /**
- * Get message type.
+ * Get message type. Throws if data is empty.
  */
 MessageType::T get_message_type(std::vector<unsigned char> &data) {
+  if (data.empty()) {
+    throw std::runtime_error("message ends early");
+  }
   return (MessageType::T)data[0];
 }
 
@@ -27,57 +119,270 @@ int put_bool(bool b, std::vector<unsigned char> &data) {
 /**
  * Puts the string s into the end of data.
  */
-int put_string(std::string s, std::vector<unsigned char> &data) {
+int put_string(const std::string &s, std::vector<unsigned char> &data) {
+  return put_bytes(std::span<const unsigned char>(
+                       (const unsigned char *)s.data(), s.size()),
+                   data);
+}
+
+/**
+ * Puts the bytes b into the end of data, in the same form as put_string.
+ */
+int put_bytes(std::span<const unsigned char> b,
+              std::vector<unsigned char> &data) {
   // Put length
   int idx = data.size();
   data.resize(idx + sizeof(size_t));
-  size_t str_size = s.size();
+  size_t str_size = b.size();
   std::memcpy(&data[idx], &str_size, sizeof(size_t));
 
-  // Put string
-  data.insert(data.end(), s.begin(), s.end());
+  // Put bytes
+  data.insert(data.end(), b.begin(), b.end());
   return data.size() - idx;
 }
 
 /**
- * Puts the integer i into the end of data.
+ * Puts the integer i into the end of data in as few bytes as it needs.
+ */
+int put_integer(CryptoPP::Integer i, std::vector<unsigned char> &data,
+                WireVersion::T version) {
+  return put_integer_bytes(i, 0, data, version);
+}
+
+/**
+ * Puts the group element x into the end of data.
  */
-int put_integer(CryptoPP::Integer i, std::vector<unsigned char> &data) {
-  return put_string(CryptoPP::IntToString(i), data);
+int put_element(const CryptoPP::Integer &x, std::vector<unsigned char> &data,
+                WireVersion::T version) {
+  return put_integer_bytes(x, ElectionGroup()->ElementSize(), data, version);
 }
 
+/**
+ * Puts the scalar x into the end of data.
+ */
+int put_scalar(const CryptoPP::Integer &x, std::vector<unsigned char> &data,
+               WireVersion::T version) {
+  return put_integer_bytes(x, ElectionGroup()->Order().ByteCount(), data,
+                           version);
+}
+
+/**
+ * Size of a string of the given length as put by put_string.
+ */
+size_t string_size(size_t length) { return sizeof(size_t) + length; }
+
+/**
+ * Size of the integer i as put by put_integer.
+ */
+size_t integer_size(const CryptoPP::Integer &i, WireVersion::T version) {
+  return integer_bytes_size(i, 0, version);
+}
+
+/**
+ * Size of the group element x as put by put_element.
+ */
+size_t element_size(const CryptoPP::Integer &x, WireVersion::T version) {
+  return integer_bytes_size(x, ElectionGroup()->ElementSize(), version);
+}
+
+/**
+ * Size of the scalar x as put by put_scalar.
+ */
+size_t scalar_size(const CryptoPP::Integer &x, WireVersion::T version) {
+  return integer_bytes_size(x, ElectionGroup()->Order().ByteCount(), version);
+}
+
+/**
+ * Size of the count and length words in front of a counted container.
+ */
+size_t container_header_size() { return 2 * sizeof(size_t); }
+
 /**
  * Puts the nest bool from data at index idx into b.
  */
 int get_bool(bool *b, std::vector<unsigned char> &data, int idx) {
-  *b = (bool)data[idx];
-  return 1;
+  ByteReader reader(std::span<const unsigned char>(data).subspan(idx));
+  *b = reader.ReadBool();
+  return reader.Consumed();
 }
 
 /**
  * Puts the nest string from data at index idx into s.
  */
 int get_string(std::string *s, std::vector<unsigned char> &data, int idx) {
-  // Get length
-  size_t str_size;
-  std::memcpy(&str_size, &data[idx], sizeof(size_t));
-
-  // Get string
-  std::vector<unsigned char> svec(&data[idx + sizeof(size_t)],
-                                  &data[idx + sizeof(size_t) + str_size]);
-  *s = chvec2str(svec);
-  return sizeof(size_t) + str_size;
+  ByteReader reader(std::span<const unsigned char>(data).subspan(idx));
+  *s = reader.ReadString();
+  return reader.Consumed();
 }
 
 /**
- * Puts the next integer from data at index idx into i.
+ * Puts the next integer from data at index idx into i, and the encoding it
+ * was written in into version if that is set.
  */
 int get_integer(CryptoPP::Integer *i, std::vector<unsigned char> &data,
-                int idx) {
-  std::string i_str;
-  int n = get_string(&i_str, data, idx);
-  *i = CryptoPP::Integer(i_str.c_str());
-  return n;
+                int idx, WireVersion::T *version) {
+  ByteReader reader(std::span<const unsigned char>(data).subspan(idx));
+  *i = reader.ReadInteger(version);
+  return reader.Consumed();
+}
+
+// ================================================
+// READER
+// ================================================
+
+ByteReader::ByteReader(std::span<const unsigned char> data)
+    : data(data), pos(0) {}
+
+bool ByteReader::AtEnd() const { return this->pos == this->data.size(); }
+
+size_t ByteReader::Consumed() const { return this->pos; }
+
+size_t ByteReader::Remaining() const { return this->data.size() - this->pos; }
+
+unsigned char ByteReader::Peek() const {
+  if (this->AtEnd()) {
+    throw std::runtime_error("message ends early");
+  }
+  return this->data[this->pos];
+}
+
+void ByteReader::Expect(MessageType::T type) {
+  if (this->ReadByte() != type) {
+    throw std::runtime_error("unexpected message type");
+  }
+}
+
+unsigned char ByteReader::ReadByte() { return this->ReadBytes(1)[0]; }
+
+bool ByteReader::ReadBool() { return (bool)this->ReadByte(); }
+
+/**
+ * The next n bytes, without copying them.
+ */
+std::span<const unsigned char> ByteReader::ReadBytes(size_t n) {
+  if (n > this->data.size() - this->pos) {
+    throw std::runtime_error("message ends early");
+  }
+  std::span<const unsigned char> bytes = this->data.subspan(this->pos, n);
+  this->pos += n;
+  return bytes;
+}
+
+size_t ByteReader::ReadSize() {
+  size_t size;
+  std::memcpy(&size, this->ReadBytes(sizeof(size_t)).data(), sizeof(size_t));
+  return size;
+}
+
+/**
+ * The bytes of the next length-prefixed field.
+ */
+std::span<const unsigned char> ByteReader::ReadField() {
+  return this->ReadBytes(this->ReadSize());
+}
+
+std::string ByteReader::ReadString() {
+  std::span<const unsigned char> bytes = this->ReadField();
+  return std::string((const char *)bytes.data(), bytes.size());
+}
+
+CryptoPP::SecByteBlock ByteReader::ReadByteBlock() {
+  std::span<const unsigned char> bytes = this->ReadField();
+  return CryptoPP::SecByteBlock(bytes.data(), bytes.size());
+}
+
+/**
+ * The next integer in either wire encoding; the encoding found goes into
+ * version if that is set.
+ */
+CryptoPP::Integer ByteReader::ReadInteger(WireVersion::T *version) {
+  if (this->data.size() - this->pos < sizeof(size_t)) {
+    throw std::runtime_error("message ends early");
+  }
+  size_t header;
+  std::memcpy(&header, this->data.data() + this->pos, sizeof(size_t));
+  WireVersion::T found = (WireVersion::T)(header >> WIRE_VERSION_SHIFT);
+  if (version) {
+    *version = found;
+  }
+
+  if (found == WireVersion::DECIMAL) {
+    return CryptoPP::Integer(this->ReadString().c_str());
+  }
+  if (found != WireVersion::BINARY) {
+    throw std::runtime_error("unknown integer encoding");
+  }
+  this->ReadBytes(sizeof(size_t));
+  std::span<const unsigned char> bytes =
+      this->ReadBytes(header & WIRE_LENGTH_MASK);
+  return CryptoPP::Integer(bytes.data(), bytes.size());
+}
+
+/**
+ * A reader over the next length-prefixed run of fields.
+ */
+ByteReader ByteReader::ReadNested() { return ByteReader(this->ReadField()); }
+
+/**
+ * A reader over the elements of the next container. The uncounted form has
+ * no header and runs to the end of this reader.
+ */
+ByteReader ByteReader::ReadContainer(MessageType::T type,
+                                     MessageType::T counted_type,
+                                     bool *counted, size_t *count) {
+  *counted = this->Peek() == counted_type;
+  this->Expect(*counted ? counted_type : type);
+  if (!*counted) {
+    *count = 0;
+    return ByteReader(this->ReadBytes(this->Remaining()));
+  }
+  *count = this->ReadSize();
+  ByteReader elements = this->ReadNested();
+  // Every element takes at least a byte; this bounds what callers reserve.
+  if (*count > elements.Remaining()) {
+    throw std::runtime_error("container count exceeds its length");
+  }
+  return elements;
+}
+
+/**
+ * Moves past the next container, counted or not.
+ */
+void ByteReader::SkipContainer() {
+  switch (this->ReadByte()) {
+  case MessageType::Multi_Vote_Ciphertext_Counted:
+  case MessageType::Multi_VoteZKP_Counted:
+  case MessageType::Multi_Integer_Counted:
+  case MessageType::Multi_String_Counted:
+    this->ReadSize();
+    this->ReadField();
+    return;
+  case MessageType::Multi_Vote_Ciphertext:
+  case MessageType::Multi_VoteZKP_Struct:
+  case MessageType::Multi_Integer:
+  case MessageType::Multi_String:
+    this->ReadBytes(this->Remaining());
+    return;
+  default:
+    throw std::runtime_error("unexpected message type");
+  }
+}
+
+/**
+ * Reserve room for the whole struct, then write it.
+ */
+void Serializable::serialize(std::vector<unsigned char> &data) {
+  data.reserve(data.size() + this->serialized_size());
+  this->write(data);
+}
+
+/**
+ * Read the struct from the front of data.
+ */
+int Serializable::deserialize(std::span<const unsigned char> data) {
+  ByteReader reader(data);
+  this->read(reader);
+  return reader.Consumed();
 }
 
 // ================================================
@@ -85,91 +390,108 @@ int get_integer(CryptoPP::Integer *i, std::vector<unsigned char> &data,
 // ================================================
 
 /**
- * serialize HMACTagged_Wrapper.
+ * serialized size of HMACTagged_Wrapper.
+ */
+size_t HMACTagged_Wrapper::serialized_size() {
+  return 1 + string_size(this->payload.size()) + string_size(this->iv.size()) +
+         string_size(this->mac.size());
+}
+
+/**
+ * write HMACTagged_Wrapper.
  */
-void HMACTagged_Wrapper::serialize(std::vector<unsigned char> &data) {
+void HMACTagged_Wrapper::write(std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::HMACTagged_Wrapper);
 
   // Add fields.
-  put_string(chvec2str(this->payload), data);
-
-  std::string iv = byteblock_to_string(this->iv);
-  put_string(iv, data);
+  put_bytes(this->payload, data);
+  put_bytes(this->iv, data);
 
   put_string(this->mac, data);
 }
 
 /**
- * deserialize HMACTagged_Wrapper.
+ * read HMACTagged_Wrapper.
  */
-int HMACTagged_Wrapper::deserialize(std::vector<unsigned char> &data) {
+void HMACTagged_Wrapper::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::HMACTagged_Wrapper);
+  reader.Expect(MessageType::HMACTagged_Wrapper);
 
   // Get fields.
-  std::string payload_string;
-  int n = 1;
-  n += get_string(&payload_string, data, n);
-  this->payload = str2chvec(payload_string);
-
-  std::string iv;
-  n += get_string(&iv, data, n);
-  this->iv = string_to_byteblock(iv);
-
-  n += get_string(&this->mac, data, n);
-  return n;
+  std::span<const unsigned char> payload = reader.ReadField();
+  this->payload.assign(payload.begin(), payload.end());
+  this->iv = reader.ReadByteBlock();
+  this->mac = reader.ReadString();
 }
 /*
 newly added, vector<Integer>
 */
-void Multi_Integer::serialize(std::vector<unsigned char> &data) {
-    // Add message type.
-    data.push_back((char)MessageType::Multi_Integer);
-    for(int i = 0; i < ints.size(); i++) {
-        put_integer(this->ints[i], data);
+size_t Multi_Integer::serialized_size() {
+    size_t size = 1 + (this->counted ? container_header_size() : 0);
+    for (CryptoPP::Integer &i : this->ints) {
+        size += integer_size(i, this->wire_version);
     }
+    return size;
 }
 
-void Multi_String::serialize(std::vector<unsigned char> &data) {
-  // Add message type
-  data.push_back((char)MessageType::Multi_String);
+void Multi_Integer::write(std::vector<unsigned char> &data) {
+    // Add message type and header.
+    size_t begin = begin_container(
+        MessageType::Multi_Integer, MessageType::Multi_Integer_Counted,
+        this->counted, this->ints.size(), data);
+    for(size_t i = 0; i < ints.size(); i++) {
+        put_integer(this->ints[i], data, this->wire_version);
+    }
+    end_container(this->counted, begin, data);
+}
 
-  for (int i = 0; i < strings.size(); i++){
+size_t Multi_String::serialized_size() {
+  size_t size = 1 + (this->counted ? container_header_size() : 0);
+  for (std::string &s : this->strings) {
+    size += string_size(s.size());
+  }
+  return size;
+}
+
+void Multi_String::write(std::vector<unsigned char> &data) {
+  // Add message type and header.
+  size_t begin = begin_container(
+      MessageType::Multi_String, MessageType::Multi_String_Counted,
+      this->counted, this->strings.size(), data);
+
+  for (size_t i = 0; i < strings.size(); i++){
     put_string(this->strings[i], data);
   }
+  end_container(this->counted, begin, data);
 }
 
-int Multi_String::deserialize(std::vector<unsigned char> &data) {
-    assert(data[0] == MessageType::Multi_String);
-    // Get fields.
-    int n = 1;
-    int idx = 0;
-    std::vector<unsigned char>::iterator iter = data.begin();
-    while(iter + n < data.end()) {
-        std::vector<unsigned char> string_slice =
-            std::vector<unsigned char>(data.begin() + n, data.end());
-        std::string str;
-        n += get_string(&str, data, n);
-        this->strings.push_back(str);
-    }
-    return n;
-}
-
-int Multi_Integer::deserialize(std::vector<unsigned char> &data) {
-    assert(data[0] == MessageType::Multi_Integer);
-    // Get fields.
-    int n = 1;
-    int idx = 0;
-    std::vector<unsigned char>::iterator iter = data.begin();
-    while(iter + n < data.end()) {
-        std::vector<unsigned char> int_slice =
-            std::vector<unsigned char>(data.begin() + n, data.end());
-        CryptoPP::Integer number;
-        n += get_integer(&number, data, n);
-        this->ints.push_back(number);
-    }
-    return n;
+void Multi_String::read(ByteReader &reader) {
+  size_t count;
+  ByteReader elements =
+      reader.ReadContainer(MessageType::Multi_String,
+                           MessageType::Multi_String_Counted, &this->counted,
+                           &count);
+  // Get fields.
+  this->strings.reserve(count);
+  while (!elements.AtEnd()) {
+    this->strings.push_back(elements.ReadString());
+  }
+  check_container(this->counted, count, this->strings.size(), elements);
+}
+
+void Multi_Integer::read(ByteReader &reader) {
+  size_t count;
+  ByteReader elements =
+      reader.ReadContainer(MessageType::Multi_Integer,
+                           MessageType::Multi_Integer_Counted, &this->counted,
+                           &count);
+  // Get fields.
+  this->ints.reserve(count);
+  while (!elements.AtEnd()) {
+    this->ints.push_back(elements.ReadInteger(&this->wire_version));
+  }
+  check_container(this->counted, count, this->ints.size(), elements);
 }
 
 // ================================================
@@ -177,69 +499,158 @@ int Multi_Integer::deserialize(std::vector<unsigned char> &data) {
 // ================================================
 
 /**
- * serialize UserToServer_DHPublicValue_Message.
+ * serialized size of UserToServer_DHPublicValue_Message.
+ */
+size_t UserToServer_DHPublicValue_Message::serialized_size() {
+  return 1 + string_size(this->public_value.size()) + 1;
+}
+
+/**
+ * write UserToServer_DHPublicValue_Message.
  */
-void UserToServer_DHPublicValue_Message::serialize(
+void UserToServer_DHPublicValue_Message::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::UserToServer_DHPublicValue_Message);
 
   // Add fields.
-  std::string public_string = byteblock_to_string(this->public_value);
-  put_string(public_string, data);
+  put_bytes(this->public_value, data);
+  data.push_back((char)this->channel_mode);
 }
 
 /**
- * deserialize UserToServer_DHPublicValue_Message.
+ * read UserToServer_DHPublicValue_Message.
  */
-int UserToServer_DHPublicValue_Message::deserialize(
-    std::vector<unsigned char> &data) {
+void UserToServer_DHPublicValue_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::UserToServer_DHPublicValue_Message);
+  reader.Expect(MessageType::UserToServer_DHPublicValue_Message);
 
   // Get fields.
-  std::string public_string;
-  int n = 1;
-  n += get_string(&public_string, data, n);
-  this->public_value = string_to_byteblock(public_string);
-  return n;
+  this->public_value = reader.ReadByteBlock();
+
+  // Clients that predate channel modes send no mode byte.
+  this->channel_mode = ChannelMode::CBC_HMAC;
+  if (!reader.AtEnd()) {
+    this->channel_mode = (ChannelMode::T)reader.ReadByte();
+  }
+}
+
+/**
+ * serialized size of ServerToUser_DHPublicValue_Message.
+ */
+size_t ServerToUser_DHPublicValue_Message::serialized_size() {
+  return 1 + string_size(this->server_public_value.size()) +
+         string_size(this->user_public_value.size()) +
+         string_size(this->server_signature.size()) + 1 +
+         string_size(this->session_ticket.size());
 }
 
 /**
- * serialize ServerToUser_DHPublicValue_Message.
+ * write ServerToUser_DHPublicValue_Message.
  */
-void ServerToUser_DHPublicValue_Message::serialize(
+void ServerToUser_DHPublicValue_Message::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::ServerToUser_DHPublicValue_Message);
 
   // Add fields.
-  std::string server_public_string =
-      byteblock_to_string(this->server_public_value);
-  std::string user_public_string = byteblock_to_string(this->user_public_value);
-  put_string(server_public_string, data);
-  put_string(user_public_string, data);
+  put_bytes(this->server_public_value, data);
+  put_bytes(this->user_public_value, data);
   put_string(this->server_signature, data);
+  data.push_back((char)this->channel_mode);
+  put_string(this->session_ticket, data);
 }
 
 /**
- * deserialize ServerToUser_DHPublicValue_Message.
+ * read ServerToUser_DHPublicValue_Message.
  */
-int ServerToUser_DHPublicValue_Message::deserialize(
-    std::vector<unsigned char> &data) {
+void ServerToUser_DHPublicValue_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::ServerToUser_DHPublicValue_Message);
+  reader.Expect(MessageType::ServerToUser_DHPublicValue_Message);
 
   // Get fields.
-  std::string server_public_string;
-  std::string user_public_string;
-  int n = 1;
-  n += get_string(&server_public_string, data, n);
-  n += get_string(&user_public_string, data, n);
-  n += get_string(&this->server_signature, data, n);
-  this->server_public_value = string_to_byteblock(server_public_string);
-  this->user_public_value = string_to_byteblock(user_public_string);
-  return n;
+  this->server_public_value = reader.ReadByteBlock();
+  this->user_public_value = reader.ReadByteBlock();
+  this->server_signature = reader.ReadString();
+
+  this->channel_mode = ChannelMode::CBC_HMAC;
+  if (!reader.AtEnd()) {
+    this->channel_mode = (ChannelMode::T)reader.ReadByte();
+  }
+  this->session_ticket.clear();
+  if (!reader.AtEnd()) {
+    this->session_ticket = reader.ReadString();
+  }
+}
+
+/**
+ * serialized size of UserToServer_Resume_Message.
+ */
+size_t UserToServer_Resume_Message::serialized_size() {
+  return 1 + string_size(this->session_ticket.size()) +
+         string_size(this->client_nonce.size()) + 1;
+}
+
+/**
+ * write UserToServer_Resume_Message.
+ */
+void UserToServer_Resume_Message::write(std::vector<unsigned char> &data) {
+  // Add message type.
+  data.push_back((char)MessageType::UserToServer_Resume_Message);
+
+  // Add fields.
+  put_string(this->session_ticket, data);
+  put_bytes(this->client_nonce, data);
+  data.push_back((char)this->channel_mode);
+}
+
+/**
+ * read UserToServer_Resume_Message.
+ */
+void UserToServer_Resume_Message::read(ByteReader &reader) {
+  // Check correct message type.
+  reader.Expect(MessageType::UserToServer_Resume_Message);
+
+  // Get fields.
+  this->session_ticket = reader.ReadString();
+  this->client_nonce = reader.ReadByteBlock();
+  this->channel_mode = (ChannelMode::T)reader.ReadByte();
+}
+
+/**
+ * serialized size of ServerToUser_Resume_Message.
+ */
+size_t ServerToUser_Resume_Message::serialized_size() {
+  return 1 + 1 + string_size(this->server_nonce.size()) + 1 +
+         string_size(this->server_confirmation.size());
+}
+
+/**
+ * write ServerToUser_Resume_Message.
+ */
+void ServerToUser_Resume_Message::write(std::vector<unsigned char> &data) {
+  // Add message type.
+  data.push_back((char)MessageType::ServerToUser_Resume_Message);
+
+  // Add fields.
+  put_bool(this->accepted, data);
+  put_bytes(this->server_nonce, data);
+  data.push_back((char)this->channel_mode);
+  put_string(this->server_confirmation, data);
+}
+
+/**
+ * read ServerToUser_Resume_Message.
+ */
+void ServerToUser_Resume_Message::read(ByteReader &reader) {
+  // Check correct message type.
+  reader.Expect(MessageType::ServerToUser_Resume_Message);
+
+  // Get fields.
+  this->accepted = reader.ReadBool();
+  this->server_nonce = reader.ReadByteBlock();
+  this->channel_mode = (ChannelMode::T)reader.ReadByte();
+  this->server_confirmation = reader.ReadString();
 }
 
 // ================================================
@@ -247,9 +658,17 @@ int ServerToUser_DHPublicValue_Message::deserialize(
 // ================================================
 
 /**
- * serialize VoterToRegistrar_Register_Message.
+ * serialized size of VoterToRegistrar_Register_Message.
  */
-void VoterToRegistrar_Register_Message::serialize(
+size_t VoterToRegistrar_Register_Message::serialized_size() {
+  return 1 + string_size(this->id.size()) +
+         integer_size(this->vote, this->wire_version);
+}
+
+/**
+ * write VoterToRegistrar_Register_Message.
+ */
+void VoterToRegistrar_Register_Message::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::VoterToRegistrar_Register_Message);
@@ -257,64 +676,65 @@ void VoterToRegistrar_Register_Message::serialize(
   // Add fields.
   put_string(this->id, data);
 //   put_string(this->candidate_id, data);
-  put_integer(this->vote, data);
+  put_integer(this->vote, data, this->wire_version);
 }
 
 /**
- * deserialize VoterToRegistrar_Register_Message.
+ * read VoterToRegistrar_Register_Message.
  */
-int VoterToRegistrar_Register_Message::deserialize(
-    std::vector<unsigned char> &data) {
+void VoterToRegistrar_Register_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::VoterToRegistrar_Register_Message);
+  reader.Expect(MessageType::VoterToRegistrar_Register_Message);
 
   // Get fields.
-  std::string user_verification_key_str;
-  int n = 1;
-  n += get_string(&this->id, data, n);
-//   n += get_string(&this->candidate_id, data, n);
-  n += get_integer(&this->vote, data, n);
-  return n;
+  this->id = reader.ReadString();
+  this->vote = reader.ReadInteger(&this->wire_version);
 }
 
 /**
- * serialize VoterToRegistrar_Register_Messages.
+ * serialized size of VoterToRegistrar_Register_Messages.
  */
-void VoterToRegistrar_Register_Messages::serialize(
+size_t VoterToRegistrar_Register_Messages::serialized_size() {
+  return 1 + string_size(this->id.size()) + this->votes.serialized_size();
+}
+
+/**
+ * write VoterToRegistrar_Register_Messages.
+ */
+void VoterToRegistrar_Register_Messages::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::VoterToRegistrar_Register_Messages);
 
   // Add fields.
-    put_string(this->id, data);
-    std::vector<unsigned char> vote_data;
-    this->votes.serialize(vote_data);
-    data.insert(data.end(), vote_data.begin(), vote_data.end());
-
+  put_string(this->id, data);
+  this->votes.write(data);
 }
 
 /**
- * deserialize VoterToRegistrar_Register_Messages.
+ * read VoterToRegistrar_Register_Messages.
  */
-int VoterToRegistrar_Register_Messages::deserialize(
-    std::vector<unsigned char> &data) {
+void VoterToRegistrar_Register_Messages::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::VoterToRegistrar_Register_Messages);
+  reader.Expect(MessageType::VoterToRegistrar_Register_Messages);
 
   // Get fields.
-    int n = 1;
-    n += get_string(&this->id, data, n);
-    std::vector<unsigned char> vote_data =
-        std::vector<unsigned char>(data.begin() + n, data.end());
-    n += this->votes.deserialize(vote_data);
+  this->id = reader.ReadString();
+  this->votes.read(reader);
+}
 
-  return n;
+/**
+ * serialized size of RegistrarToVoter_Blind_Signature_Message.
+ */
+size_t RegistrarToVoter_Blind_Signature_Message::serialized_size() {
+  return 1 + string_size(this->id.size()) +
+         integer_size(this->registrar_signature, this->wire_version);
 }
 
 /**
- * serialize RegistrarToVoter_Blind_Signature_Message.
+ * write RegistrarToVoter_Blind_Signature_Message.
  */
-void RegistrarToVoter_Blind_Signature_Message::serialize(
+void RegistrarToVoter_Blind_Signature_Message::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::RegistrarToVoter_Blind_Signature_Message);
@@ -323,60 +743,52 @@ void RegistrarToVoter_Blind_Signature_Message::serialize(
   put_string(this->id, data);
 //   put_string(this->candidate_id, data);
 
-  put_integer(this->registrar_signature, data);
+  put_integer(this->registrar_signature, data, this->wire_version);
 }
 
 /**
- * deserialize RegistrarToVoter_Blind_Signature_Message.
+ * read RegistrarToVoter_Blind_Signature_Message.
  */
-int RegistrarToVoter_Blind_Signature_Message::deserialize(
-    std::vector<unsigned char> &data) {
+void RegistrarToVoter_Blind_Signature_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::RegistrarToVoter_Blind_Signature_Message);
+  reader.Expect(MessageType::RegistrarToVoter_Blind_Signature_Message);
 
   // Get fields.
-  int n = 1;
-  n += get_string(&this->id, data, n);
-//   n += get_string(&this->candidate_id, data, n);
-  n += get_integer(&this->registrar_signature, data, n);
+  this->id = reader.ReadString();
+  this->registrar_signature = reader.ReadInteger(&this->wire_version);
+}
 
-  return n;
+/**
+ * serialized size of RegistrarToVoter_Blind_Signature_Messages.
+ */
+size_t RegistrarToVoter_Blind_Signature_Messages::serialized_size() {
+  return 1 + string_size(this->id.size()) +
+         this->registrar_signatures.serialized_size();
 }
 
 /**
- * serialize RegistrarToVoter_Blind_Signature_Messages.
+ * write RegistrarToVoter_Blind_Signature_Messages.
  */
-void RegistrarToVoter_Blind_Signature_Messages::serialize(
+void RegistrarToVoter_Blind_Signature_Messages::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::RegistrarToVoter_Blind_Signature_Messages);
 
   // Add fields.
   put_string(this->id, data);
-    
-    std::vector<unsigned char> signature_data;
-    this->registrar_signatures.serialize(signature_data);
-    data.insert(data.end(), signature_data.begin(), signature_data.end());
-
+  this->registrar_signatures.write(data);
 }
 
 /**
- * deserialize RegistrarToVoter_Blind_Signature_Messages.
+ * read RegistrarToVoter_Blind_Signature_Messages.
  */
-int RegistrarToVoter_Blind_Signature_Messages::deserialize(
-    std::vector<unsigned char> &data) {
+void RegistrarToVoter_Blind_Signature_Messages::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::RegistrarToVoter_Blind_Signature_Messages);
+  reader.Expect(MessageType::RegistrarToVoter_Blind_Signature_Messages);
 
   // Get fields.
-  int n = 1;
-  n += get_string(&this->id, data, n);
-   std::vector<unsigned char> sign_data =
-        std::vector<unsigned char>(data.begin() + n, data.end());
-    n += this->registrar_signatures.deserialize(sign_data);
-
-
-  return n;
+  this->id = reader.ReadString();
+  this->registrar_signatures.read(reader);
 }
 
 // ================================================
@@ -384,277 +796,338 @@ int RegistrarToVoter_Blind_Signature_Messages::deserialize(
 // ================================================
 
 /**
- * serialize Vote_Ciphertext.
+ * serialized size of Vote_Ciphertext.
+ */
+size_t Vote_Ciphertext::serialized_size() {
+  return 1 + element_size(this->a, this->wire_version) +
+         element_size(this->b, this->wire_version);
+}
+
+/**
+ * write Vote_Ciphertext.
  */
-void Vote_Ciphertext::serialize(std::vector<unsigned char> &data) {
+void Vote_Ciphertext::write(std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::Vote_Ciphertext);
 
   // Add fields.
-  put_integer(this->a, data);
-  put_integer(this->b, data);
+  put_element(this->a, data, this->wire_version);
+  put_element(this->b, data, this->wire_version);
 }
 
 /**
- * deserialize Vote_Ciphertext.
+ * read Vote_Ciphertext.
  */
-int Vote_Ciphertext::deserialize(std::vector<unsigned char> &data) {
+void Vote_Ciphertext::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::Vote_Ciphertext);
+  reader.Expect(MessageType::Vote_Ciphertext);
 
   // Get fields.
-  int n = 1;
-  n += get_integer(&this->a, data, n);
-  n += get_integer(&this->b, data, n);
-  return n;
+  this->a = reader.ReadInteger(&this->wire_version);
+  this->b = reader.ReadInteger(&this->wire_version);
 }
 
 /**
- * serialize Multi_Vote_Ciphertext.
+ * serialized size of Multi_Vote_Ciphertext.
  */
-void Multi_Vote_Ciphertext::serialize(std::vector<unsigned char> &data) {
-  // Add message type.
-  data.push_back((char)MessageType::Multi_Vote_Ciphertext);
+size_t Multi_Vote_Ciphertext::serialized_size() {
+  size_t size = 1 + (this->counted ? container_header_size() : 0);
+  for (Vote_Ciphertext &vote : this->ct) {
+    size += vote.serialized_size();
+  }
+  return size;
+}
+
+/**
+ * write Multi_Vote_Ciphertext.
+ */
+void Multi_Vote_Ciphertext::write(std::vector<unsigned char> &data) {
+  // Add message type and header.
+  size_t begin = begin_container(
+      MessageType::Multi_Vote_Ciphertext,
+      MessageType::Multi_Vote_Ciphertext_Counted, this->counted,
+      this->ct.size(), data);
 
   // Add fields.
-  for(int i = 0; i < this->ct.size(); i++) {
-    std::vector<unsigned char> vote_data;
-    this->ct[i].serialize(vote_data);
-    data.insert(data.end(), vote_data.begin(), vote_data.end());
+  for(size_t i = 0; i < this->ct.size(); i++) {
+    this->ct[i].write(data);
   }
+  end_container(this->counted, begin, data);
 }
 
 /**
- * deserialize Multi_Vote_Ciphertext.
+ * read Multi_Vote_Ciphertext.
  */
-int Multi_Vote_Ciphertext::deserialize(std::vector<unsigned char> &data) {
+void Multi_Vote_Ciphertext::read(ByteReader &reader) {
   // Check correct message type.
+  size_t count;
+  ByteReader elements = reader.ReadContainer(
+      MessageType::Multi_Vote_Ciphertext,
+      MessageType::Multi_Vote_Ciphertext_Counted, &this->counted, &count);
 
-  assert(data[0] == MessageType::Multi_Vote_Ciphertext);
   // Get fields.
-  int n = 1;
-  int idx = 0;
-  std::vector<unsigned char>::iterator iter = data.begin();
-  while(iter + n < data.end()) {
-    std::vector<unsigned char> vote_slice =
-        std::vector<unsigned char>(data.begin() + n, data.end());
-    Vote_Ciphertext vote;
-    n += vote.deserialize(vote_slice);
-    this->ct.push_back(vote);
+  this->ct.reserve(count);
+  while (!elements.AtEnd()) {
+    this->ct.emplace_back().read(elements);
+  }
+  check_container(this->counted, count, this->ct.size(), elements);
+}
+
+/**
+ * serialized size of VoteZKP_Struct.
+ */
+size_t VoteZKP_Struct::serialized_size() {
+  size_t size = 1 + scalar_size(this->c0, this->wire_version) +
+                scalar_size(this->c1, this->wire_version) +
+                scalar_size(this->r0, this->wire_version) +
+                scalar_size(this->r1, this->wire_version);
+  if (!this->compact) {
+    size += element_size(this->a0, this->wire_version) +
+            element_size(this->a1, this->wire_version) +
+            element_size(this->b0, this->wire_version) +
+            element_size(this->b1, this->wire_version);
   }
-  return n;
+  return size;
 }
 
 /**
- * serialize VoteZKP_Struct.
+ * write VoteZKP_Struct.
  */
-void VoteZKP_Struct::serialize(std::vector<unsigned char> &data) {
+void VoteZKP_Struct::write(std::vector<unsigned char> &data) {
+  if (this->compact) {
+    data.push_back((char)MessageType::VoteZKP_Compact);
+    put_scalar(this->c0, data, this->wire_version);
+    put_scalar(this->c1, data, this->wire_version);
+    put_scalar(this->r0, data, this->wire_version);
+    put_scalar(this->r1, data, this->wire_version);
+    return;
+  }
+
   // Add message type.
   data.push_back((char)MessageType::VoteZKP_Struct);
 
   // Add fields.
-  put_integer(this->a0, data);
-  put_integer(this->a1, data);
-  put_integer(this->b0, data);
-  put_integer(this->b1, data);
-  put_integer(this->c0, data);
-  put_integer(this->c1, data);
-  put_integer(this->r0, data);
-  put_integer(this->r1, data);
+  put_element(this->a0, data, this->wire_version);
+  put_element(this->a1, data, this->wire_version);
+  put_element(this->b0, data, this->wire_version);
+  put_element(this->b1, data, this->wire_version);
+  put_scalar(this->c0, data, this->wire_version);
+  put_scalar(this->c1, data, this->wire_version);
+  put_scalar(this->r0, data, this->wire_version);
+  put_scalar(this->r1, data, this->wire_version);
 }
 
 /**
- * deserialize VoteZKP_Struct.
+ * read VoteZKP_Struct.
  */
-int VoteZKP_Struct::deserialize(std::vector<unsigned char> &data) {
+void VoteZKP_Struct::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::VoteZKP_Struct);
+  this->compact = reader.Peek() == MessageType::VoteZKP_Compact;
+  reader.Expect(this->compact ? MessageType::VoteZKP_Compact
+                              : MessageType::VoteZKP_Struct);
 
   // Get fields.
-  int n = 1;
-  n += get_integer(&this->a0, data, n);
-  n += get_integer(&this->a1, data, n);
-  n += get_integer(&this->b0, data, n);
-  n += get_integer(&this->b1, data, n);
-  n += get_integer(&this->c0, data, n);
-  n += get_integer(&this->c1, data, n);
-  n += get_integer(&this->r0, data, n);
-  n += get_integer(&this->r1, data, n);
-  return n;
+  if (!this->compact) {
+    this->a0 = reader.ReadInteger(&this->wire_version);
+    this->a1 = reader.ReadInteger(&this->wire_version);
+    this->b0 = reader.ReadInteger(&this->wire_version);
+    this->b1 = reader.ReadInteger(&this->wire_version);
+  }
+  this->c0 = reader.ReadInteger(&this->wire_version);
+  this->c1 = reader.ReadInteger(&this->wire_version);
+  this->r0 = reader.ReadInteger(&this->wire_version);
+  this->r1 = reader.ReadInteger(&this->wire_version);
 }
 
 /**
- * serialize Multi_VoteZKP_Struct.
+ * serialized size of SumZKP_Struct.
  */
-void Multi_VoteZKP_Struct::serialize(std::vector<unsigned char> &data) {
+size_t SumZKP_Struct::serialized_size() {
+  size_t size = 1 + integer_size(CryptoPP::Integer((long)this->a.size()),
+                                this->wire_version);
+  for (size_t i = 0; i < this->a.size(); i++) {
+    size += element_size(this->a[i], this->wire_version) +
+            element_size(this->b[i], this->wire_version) +
+            scalar_size(this->c[i], this->wire_version) +
+            scalar_size(this->r[i], this->wire_version);
+  }
+  return size;
+}
+
+/**
+ * write SumZKP_Struct.
+ */
+void SumZKP_Struct::write(std::vector<unsigned char> &data) {
   // Add message type.
-  data.push_back((char)MessageType::Multi_VoteZKP_Struct);
+  data.push_back((char)MessageType::SumZKP_Struct);
 
   // Add fields.
-  for(int i = 0; i < this->zkp.size(); i++) {
-    std::vector<unsigned char> zkp_data;
-    this->zkp[i].serialize(zkp_data);
-    data.insert(data.end(), zkp_data.begin(), zkp_data.end());
+  put_integer(CryptoPP::Integer((long)this->a.size()), data,
+              this->wire_version);
+  for (size_t i = 0; i < this->a.size(); i++) {
+    put_element(this->a[i], data, this->wire_version);
+    put_element(this->b[i], data, this->wire_version);
+    put_scalar(this->c[i], data, this->wire_version);
+    put_scalar(this->r[i], data, this->wire_version);
   }
 }
 
 /**
- * deserialize Multi_VoteZKP_Struct.
+ * read SumZKP_Struct.
  */
-int Multi_VoteZKP_Struct::deserialize(std::vector<unsigned char> &data) {
+void SumZKP_Struct::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::Multi_VoteZKP_Struct);
+  reader.Expect(MessageType::SumZKP_Struct);
 
   // Get fields.
-  int n = 1;
-  std::vector<unsigned char>::iterator iter = data.begin();
-  while(iter + n < data.end()) {
-    std::vector<unsigned char> zkp_slice =
-        std::vector<unsigned char>(data.begin() + n, data.end());
-    VoteZKP_Struct single_zkp;
-    n += single_zkp.deserialize(zkp_slice);
-    this->zkp.push_back(single_zkp);
+  CryptoPP::Integer count_field = reader.ReadInteger(&this->wire_version);
+  // Every entry is four fields of at least a byte; this bounds the resize.
+  if (count_field.IsNegative() ||
+      count_field > CryptoPP::Integer((long)(reader.Remaining() / 4))) {
+    throw std::runtime_error("sum proof count exceeds its length");
   }
+  size_t count = count_field.ConvertToLong();
+  this->a.resize(count);
+  this->b.resize(count);
+  this->c.resize(count);
+  this->r.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    this->a[i] = reader.ReadInteger(&this->wire_version);
+    this->b[i] = reader.ReadInteger(&this->wire_version);
+    this->c[i] = reader.ReadInteger(&this->wire_version);
+    this->r[i] = reader.ReadInteger(&this->wire_version);
+  }
+}
 
-  return n;
+/**
+ * serialized size of Multi_VoteZKP_Struct.
+ */
+size_t Multi_VoteZKP_Struct::serialized_size() {
+  size_t size = 1 + (this->counted ? container_header_size() : 0);
+  for (VoteZKP_Struct &single_zkp : this->zkp) {
+    size += single_zkp.serialized_size();
+  }
+  if (this->sum) {
+    size += this->sum->serialized_size();
+  }
+  return size;
 }
 
 /**
- * serialize VoterToTallyer_Vote_Message.
+ * write Multi_VoteZKP_Struct.
  */
-void VoterToTallyer_Vote_Message::serialize(std::vector<unsigned char> &data) {
-  // Add message type.
-  data.push_back((char)MessageType::VoterToTallyer_Vote_Message);
+void Multi_VoteZKP_Struct::write(std::vector<unsigned char> &data) {
+  // Add message type and header.
+  size_t begin = begin_container(
+      MessageType::Multi_VoteZKP_Struct, MessageType::Multi_VoteZKP_Counted,
+      this->counted, this->zkp.size(), data);
 
   // Add fields.
-
-  std::vector<unsigned char> vote_data;
-  this->votes.serialize(vote_data);
-  data.insert(data.end(), vote_data.begin(), vote_data.end());
-
-  data.push_back(delimiter);
-
-    std::vector<unsigned char> sign_data;
-    this->unblinded_signatures.serialize(sign_data);
-    data.insert(data.end(), sign_data.begin(), sign_data.end());
-
-  data.push_back(delimiter);
-
-  std::vector<unsigned char> zkp_data;
-  this->zkps.serialize(zkp_data);
-  data.insert(data.end(), zkp_data.begin(), zkp_data.end());
+  for(size_t i = 0; i < this->zkp.size(); i++) {
+    this->zkp[i].write(data);
+  }
+  if (this->sum) {
+    this->sum->write(data);
+  }
+  end_container(this->counted, begin, data);
 }
 
 /**
- * deserialize VoterToTallyer_Vote_Message.
+ * read Multi_VoteZKP_Struct.
  */
-int VoterToTallyer_Vote_Message::deserialize(std::vector<unsigned char> &data) {
-    std::cout<<static_cast<int>(data[0])<<std::endl;
+void Multi_VoteZKP_Struct::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::VoterToTallyer_Vote_Message);
-  // Get fields.
-  int n = 1;
-
-    std::vector<unsigned char> sub_data(data.begin() + n, data.end());
-    std::vector<std::string> data_strs=  string_split(chvec2str(sub_data), delimiter);
-    // std::cout<<"size:"<<data_strs.size()<<std::endl;
-    assert(data_strs.size() == 3);
-    std::vector<std::vector<unsigned char>> slice_datas(3);
-    slice_datas[0] = str2chvec(data_strs[0]);
+  size_t count;
+  ByteReader elements = reader.ReadContainer(
+      MessageType::Multi_VoteZKP_Struct, MessageType::Multi_VoteZKP_Counted,
+      &this->counted, &count);
 
-      std::vector<unsigned char> vote_slice =
-      std::vector<unsigned char>(slice_datas[0].begin(), slice_datas[0].end());
-  n += this->votes.deserialize(vote_slice);
-    std::cout<<"vote_slice"<<" ";
-
-    slice_datas[1] = str2chvec(data_strs[1]);
-      std::vector<unsigned char> sign_slice =
-      std::vector<unsigned char>(slice_datas[1].begin(), slice_datas[1].end());
-  n += this->unblinded_signatures.deserialize(sign_slice);
-    std::cout<<"sign_slice"<<" ";
+  // Get fields.
+  this->zkp.reserve(count);
+  while (!elements.AtEnd()) {
+    if (elements.Peek() == MessageType::SumZKP_Struct) {
+      this->sum.emplace().read(elements);
+      break;
+    }
+    this->zkp.emplace_back().read(elements);
+  }
+  check_container(this->counted, count, this->zkp.size(), elements);
+}
 
-    slice_datas[2] = str2chvec(data_strs[2]);
-      std::vector<unsigned char> zkp_slice =
-      std::vector<unsigned char>(slice_datas[2].begin(), slice_datas[2].end());
-  n += this->zkps.deserialize(zkp_slice);
+/**
+ * serialized size of VoterToTallyer_Vote_Message.
+ */
+size_t VoterToTallyer_Vote_Message::serialized_size() {
+  require_counted(this->votes, this->zkps, this->unblinded_signatures);
+  return 1 + this->votes.serialized_size() +
+         this->unblinded_signatures.serialized_size() +
+         this->zkps.serialized_size();
+}
 
-//   std::vector<unsigned char> vote_slice =
-//       std::vector<unsigned char>(first_slice_data.begin() + n, data.end());
-//   n += this->votes.deserialize(vote_slice);
-//     std::cout<<"vote_slice"<<" ";
+/**
+ * write VoterToTallyer_Vote_Message.
+ */
+void VoterToTallyer_Vote_Message::write(std::vector<unsigned char> &data) {
+  // Add message type.
+  data.push_back((char)MessageType::VoterToTallyer_Vote_Message);
 
-//   std::vector<unsigned char> sign_slice =
-//       std::vector<unsigned char>(data.begin() + n, data.end());
-//   n += this->unblinded_signatures.deserialize(sign_slice);
-//     std::cout<<"sign_slice"<<" ";
+  // Add fields.
+  require_counted(this->votes, this->zkps, this->unblinded_signatures);
+  this->votes.write(data);
+  this->unblinded_signatures.write(data);
+  this->zkps.write(data);
+}
 
-//   std::vector<unsigned char> zkp_slice =
-//       std::vector<unsigned char>(data.begin() + n, data.end());
-//   n += this->zkps.deserialize(zkp_slice);
+/**
+ * read VoterToTallyer_Vote_Message.
+ */
+void VoterToTallyer_Vote_Message::read(ByteReader &reader) {
+  // Check correct message type.
+  reader.Expect(MessageType::VoterToTallyer_Vote_Message);
 
+  // Get fields.
+  this->votes.read(reader);
+  this->unblinded_signatures.read(reader);
+  this->zkps.read(reader);
+}
 
-  return n;
+/**
+ * serialized size of TallyerToWorld_Vote_Message.
+ */
+size_t TallyerToWorld_Vote_Message::serialized_size() {
+  require_counted(this->votes, this->zkps, this->unblinded_signatures);
+  return 1 + this->votes.serialized_size() + this->zkps.serialized_size() +
+         this->unblinded_signatures.serialized_size() +
+         string_size(this->tallyer_signatures.size());
 }
 
 /**
- * serialize TallyerToWorld_Vote_Message.
+ * write TallyerToWorld_Vote_Message.
  */
-void TallyerToWorld_Vote_Message::serialize(std::vector<unsigned char> &data) {
+void TallyerToWorld_Vote_Message::write(std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::TallyerToWorld_Vote_Message);
 
   // Add fields.
-  std::vector<unsigned char> vote_data;
-  this->votes.serialize(vote_data);
-  data.insert(data.end(), vote_data.begin(), vote_data.end());
-  data.push_back(delimiter);
-
-  std::vector<unsigned char> zkp_data;
-  this->zkps.serialize(zkp_data);
-  data.insert(data.end(), zkp_data.begin(), zkp_data.end());
-  data.push_back(delimiter);
-
-  std::vector<unsigned char> int_data;
-  this->unblinded_signatures.serialize(int_data);
-  data.insert(data.end(), int_data.begin(), int_data.end());
-  data.push_back(delimiter);
-
+  require_counted(this->votes, this->zkps, this->unblinded_signatures);
+  this->votes.write(data);
+  this->zkps.write(data);
+  this->unblinded_signatures.write(data);
   put_string(this->tallyer_signatures, data);
 }
 
 /**
- * deserialize TallyerToWorld_Vote_Message.
+ * read TallyerToWorld_Vote_Message.
  */
-int TallyerToWorld_Vote_Message::deserialize(std::vector<unsigned char> &data) {
+void TallyerToWorld_Vote_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::TallyerToWorld_Vote_Message);
+  reader.Expect(MessageType::TallyerToWorld_Vote_Message);
 
   // Get fields.
-  int n = 1;
-  std::vector<unsigned char> sub_data(data.begin() + n, data.end());
-    std::vector<std::string> data_strs=  string_split(chvec2str(sub_data), delimiter);
-    std::cout<<"size:"<<data_strs.size()<<std::endl;
-    assert(data_strs.size() >= 4); // 因为tallyer_signatures是乱码，可能会有字符和delimiter相等。所以把第四节及其以后都算作tallyer_signatures
-    std::vector<std::vector<unsigned char>> slice_datas(4);
-
-    slice_datas[0] = str2chvec(data_strs[0]);
-
-  std::vector<unsigned char> vote_slice =
-      std::vector<unsigned char>(slice_datas[0].begin(), slice_datas[0].end());
-  n += this->votes.deserialize(vote_slice);
-
-    slice_datas[1] = str2chvec(data_strs[1]);
-  std::vector<unsigned char> zkp_slice =
-      std::vector<unsigned char>(slice_datas[1].begin(), slice_datas[1].end());
-  n += this->zkps.deserialize(zkp_slice);
-
-    slice_datas[2] = str2chvec(data_strs[2]);
-  std::vector<unsigned char> signature_slice =
-      std::vector<unsigned char>(slice_datas[2].begin(), slice_datas[2].end());
-  n += this->unblinded_signatures.deserialize(signature_slice);
-
-  n += get_string(&this->tallyer_signatures, data, n+3);
-  return n;
+  this->votes.read(reader);
+  this->zkps.read(reader);
+  this->unblinded_signatures.read(reader);
+  this->tallyer_signatures = reader.ReadString();
 }
 
 // ================================================
@@ -662,68 +1135,103 @@ int TallyerToWorld_Vote_Message::deserialize(std::vector<unsigned char> &data) {
 // ================================================
 
 /**
- * serialize PartialDecryption_Struct.
+ * serialized size of PartialDecryption_Struct.
  */
-void PartialDecryption_Struct::serialize(std::vector<unsigned char> &data) {
+size_t PartialDecryption_Struct::serialized_size() {
+  return 1 + element_size(this->d, this->wire_version) +
+         this->aggregate_ciphertext.serialized_size();
+}
+
+/**
+ * write PartialDecryption_Struct.
+ */
+void PartialDecryption_Struct::write(std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::PartialDecryption_Struct);
 
   // Add fields.
-  put_integer(this->d, data);
-  std::vector<unsigned char> aggregate_ciphertext_data;
-  this->aggregate_ciphertext.serialize(aggregate_ciphertext_data);
-  data.insert(data.end(), aggregate_ciphertext_data.begin(),
-              aggregate_ciphertext_data.end());
+  put_element(this->d, data, this->wire_version);
+  this->aggregate_ciphertext.write(data);
 }
 
 /**
- * deserialize PartialDecryption_Struct.
+ * read PartialDecryption_Struct.
  */
-int PartialDecryption_Struct::deserialize(std::vector<unsigned char> &data) {
+void PartialDecryption_Struct::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::PartialDecryption_Struct);
+  reader.Expect(MessageType::PartialDecryption_Struct);
 
   // Get fields.
-  int n = 1;
-  n += get_integer(&this->d, data, n);
-  std::vector<unsigned char> aggregate_ciphertext_slice =
-      std::vector<unsigned char>(data.begin() + n, data.end());
-  n += this->aggregate_ciphertext.deserialize(aggregate_ciphertext_slice);
-  return n;
+  this->d = reader.ReadInteger(&this->wire_version);
+  this->aggregate_ciphertext.read(reader);
 }
 
 /**
- * serialize DecryptionZKP_Struct.
+ * serialized size of DecryptionZKP_Struct.
  */
-void DecryptionZKP_Struct::serialize(std::vector<unsigned char> &data) {
+size_t DecryptionZKP_Struct::serialized_size() {
+  if (this->compact) {
+    return 1 + scalar_size(this->c, this->wire_version) +
+           scalar_size(this->s, this->wire_version);
+  }
+  return 1 + element_size(this->u, this->wire_version) +
+         element_size(this->v, this->wire_version) +
+         scalar_size(this->s, this->wire_version);
+}
+
+/**
+ * write DecryptionZKP_Struct.
+ */
+void DecryptionZKP_Struct::write(std::vector<unsigned char> &data) {
+  if (this->compact) {
+    data.push_back((char)MessageType::DecryptionZKP_Compact);
+    put_scalar(this->c, data, this->wire_version);
+    put_scalar(this->s, data, this->wire_version);
+    return;
+  }
+
   // Add message type.
   data.push_back((char)MessageType::DecryptionZKP_Struct);
 
   // Add fields.
-  put_integer(this->u, data);
-  put_integer(this->v, data);
-  put_integer(this->s, data);
+  put_element(this->u, data, this->wire_version);
+  put_element(this->v, data, this->wire_version);
+  put_scalar(this->s, data, this->wire_version);
 }
 
 /**
- * deserialize DecryptionZKP_Struct.
+ * read DecryptionZKP_Struct.
  */
-int DecryptionZKP_Struct::deserialize(std::vector<unsigned char> &data) {
+void DecryptionZKP_Struct::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::DecryptionZKP_Struct);
+  this->compact = reader.Peek() == MessageType::DecryptionZKP_Compact;
+  reader.Expect(this->compact ? MessageType::DecryptionZKP_Compact
+                              : MessageType::DecryptionZKP_Struct);
 
   // Get fields.
-  int n = 1;
-  n += get_integer(&this->u, data, n);
-  n += get_integer(&this->v, data, n);
-  n += get_integer(&this->s, data, n);
-  return n;
+  if (this->compact) {
+    this->c = reader.ReadInteger(&this->wire_version);
+    this->s = reader.ReadInteger(&this->wire_version);
+    return;
+  }
+  this->u = reader.ReadInteger(&this->wire_version);
+  this->v = reader.ReadInteger(&this->wire_version);
+  this->s = reader.ReadInteger(&this->wire_version);
+}
+
+/**
+ * serialized size of ArbiterToWorld_PartialDecryption_Message.
+ */
+size_t ArbiterToWorld_PartialDecryption_Message::serialized_size() {
+  return 1 + string_size(this->arbiter_id.size()) +
+         string_size(this->arbiter_vk_path.size()) +
+         this->dec.serialized_size() + this->zkp.serialized_size();
 }
 
 /**
- * serialize ArbiterToWorld_PartialDecryption_Message.
+ * write ArbiterToWorld_PartialDecryption_Message.
  */
-void ArbiterToWorld_PartialDecryption_Message::serialize(
+void ArbiterToWorld_PartialDecryption_Message::write(
     std::vector<unsigned char> &data) {
   // Add message type.
   data.push_back((char)MessageType::ArbiterToWorld_PartialDecryption_Message);
@@ -733,37 +1241,22 @@ void ArbiterToWorld_PartialDecryption_Message::serialize(
 
   put_string(this->arbiter_vk_path, data);
 
-  std::vector<unsigned char> dec_data;
-  this->dec.serialize(dec_data);
-  data.insert(data.end(), dec_data.begin(), dec_data.end());
-
-  std::vector<unsigned char> zkp_data;
-  this->zkp.serialize(zkp_data);
-  data.insert(data.end(), zkp_data.begin(), zkp_data.end());
+  this->dec.write(data);
+  this->zkp.write(data);
 }
 
 /**
- * deserialize ArbiterToWorld_PartialDecryption_Message.
+ * read ArbiterToWorld_PartialDecryption_Message.
  */
-int ArbiterToWorld_PartialDecryption_Message::deserialize(
-    std::vector<unsigned char> &data) {
+void ArbiterToWorld_PartialDecryption_Message::read(ByteReader &reader) {
   // Check correct message type.
-  assert(data[0] == MessageType::ArbiterToWorld_PartialDecryption_Message);
+  reader.Expect(MessageType::ArbiterToWorld_PartialDecryption_Message);
 
   // Get fields.
-  int n = 1;
-  n += get_string(&this->arbiter_id, data, n);
-
-  n += get_string(&this->arbiter_vk_path, data, n);
-
-  std::vector<unsigned char> dec_slice =
-      std::vector<unsigned char>(data.begin() + n, data.end());
-  n += this->dec.deserialize(dec_slice);
-
-  std::vector<unsigned char> zkp_slice =
-      std::vector<unsigned char>(data.begin() + n, data.end());
-  n += this->zkp.deserialize(zkp_slice);
-  return n;
+  this->arbiter_id = reader.ReadString();
+  this->arbiter_vk_path = reader.ReadString();
+  this->dec.read(reader);
+  this->zkp.read(reader);
 }
 
 // ================================================
@@ -786,6 +1279,18 @@ std::vector<unsigned char> concat_byteblocks(CryptoPP::SecByteBlock &b1,
   return v;
 }
 
+/**
+ * Concatenate the DH values and the chosen channel mode; this is what the
+ * server signs, so the mode cannot be changed in transit.
+ */
+std::vector<unsigned char>
+concat_dh_values_and_mode(ServerToUser_DHPublicValue_Message &msg) {
+  std::vector<unsigned char> v =
+      concat_byteblocks(msg.server_public_value, msg.user_public_value);
+  v.push_back((unsigned char)msg.channel_mode);
+  return v;
+}
+
 /**
  * Concatenate a vote and zkp into vector of unsigned char
  */
@@ -814,18 +1319,12 @@ Concatenate votes and zkps into vector of unsigned char
 std::vector<unsigned char>
 concat_votes_zkps_and_signatures(Multi_Vote_Ciphertext &vote, Multi_VoteZKP_Struct &zkp,
                               Multi_Integer &signature) {
-  // Serialize vote and zkp.
-  std::vector<unsigned char> vote_data;
-  vote.serialize(vote_data);
-  std::vector<unsigned char> zkp_data;
-  zkp.serialize(zkp_data);
-  std::vector<unsigned char> signature_data;
-  signature.serialize(signature_data);
-
-  // Concat data to vec.
+  // Serialize votes, zkps and signatures back to back into one vec.
   std::vector<unsigned char> v;
-  v.insert(v.end(), vote_data.begin(), vote_data.end());
-  v.insert(v.end(), zkp_data.begin(), zkp_data.end());
-  v.insert(v.end(), signature_data.begin(), signature_data.end());
+  v.reserve(vote.serialized_size() + zkp.serialized_size() +
+            signature.serialized_size());
+  vote.write(v);
+  zkp.write(v);
+  signature.write(v);
   return v;
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <pthread.h>
+
+#include <crypto++/osrng.h>
+
+#include "../include-shared/rng.hpp"
+
+namespace {
+const uint64_t RNG_RESEED_CALLS = 1 << 16;
+const std::chrono::seconds RNG_RESEED_SECONDS(300);
+
+// Bumped in the child on every fork(), so inherited pools know to reseed.
+std::atomic<uint64_t> fork_generation(0);
+std::once_flag fork_handler_once;
+
+void on_fork_child() { fork_generation++; }
+
+struct ThreadPool {
+  std::unique_ptr<CryptoPP::AutoSeededRandomPool> pool;
+  uint64_t generation = 0;
+  uint64_t calls = 0;
+  std::chrono::steady_clock::time_point seeded_at;
+};
+thread_local ThreadPool thread_pool;
+} // namespace
+
+/**
+ * The calling thread's generator, reseeding it first if it is due.
+ */
+CryptoPP::RandomNumberGenerator &ThreadRNG() {
+  ThreadPool &state = thread_pool;
+  uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  auto now = std::chrono::steady_clock::now();
+
+  if (!state.pool) {
+    std::call_once(fork_handler_once,
+                   []() { pthread_atfork(nullptr, nullptr, on_fork_child); });
+    state.pool = std::make_unique<CryptoPP::AutoSeededRandomPool>();
+  } else if (state.generation != generation ||
+             state.calls >= RNG_RESEED_CALLS ||
+             now - state.seeded_at >= RNG_RESEED_SECONDS) {
+    state.pool->Reseed();
+  } else {
+    state.calls++;
+    return *state.pool;
+  }
+  state.generation = generation;
+  state.calls = 1;
+  state.seeded_at = now;
+  return *state.pool;
+}
@@ -0,0 +1,88 @@
+#include <stdexcept>
+#include <vector>
+
+#include "../include-shared/transcript.hpp"
+
+namespace {
+/**
+ * Append x as an 8-byte big-endian integer.
+ */
+void put_uint64(uint64_t x, std::vector<CryptoPP::byte> &data) {
+  for (int i = 7; i >= 0; i--) {
+    data.push_back(static_cast<CryptoPP::byte>(x >> (8 * i)));
+  }
+}
+} // namespace
+
+/**
+ * Start a transcript for the proof named domain over group.
+ */
+Transcript::Transcript(const std::string &domain, const Group &group)
+    : group(group) {
+  this->AbsorbLabel(domain);
+  this->AbsorbLabel(group.Name());
+}
+
+/**
+ * Absorb a group element at the group's element width.
+ */
+void Transcript::AbsorbElement(const std::string &tag,
+                               const CryptoPP::Integer &x) {
+  this->Absorb(tag, x, this->group.ElementSize());
+}
+
+/**
+ * Absorb a small non-negative integer (e.g. a vote count).
+ */
+void Transcript::AbsorbUint(const std::string &tag, uint64_t x) {
+  this->AbsorbLabel(tag);
+  std::vector<CryptoPP::byte> data;
+  put_uint64(8, data);
+  put_uint64(x, data);
+  this->hash.Update(data.data(), data.size());
+}
+
+/**
+ * Finish the transcript. The digest is expanded to two blocks,
+ * SHA-256(digest || 0) || SHA-256(digest || 1), before reducing mod q.
+ */
+CryptoPP::Integer Transcript::Challenge() {
+  CryptoPP::byte digest[CryptoPP::SHA256::DIGESTSIZE + 1];
+  this->hash.Final(digest);
+
+  CryptoPP::byte wide[2 * CryptoPP::SHA256::DIGESTSIZE];
+  for (int block = 0; block < 2; block++) {
+    digest[CryptoPP::SHA256::DIGESTSIZE] = static_cast<CryptoPP::byte>(block);
+    CryptoPP::SHA256 expand;
+    expand.Update(digest, sizeof(digest));
+    expand.Final(wide + block * CryptoPP::SHA256::DIGESTSIZE);
+  }
+  return CryptoPP::Integer(wide, sizeof(wide)) % this->group.Order();
+}
+
+/**
+ * Absorb tag, width, then x as width big-endian bytes. Throws if x is
+ * negative or does not fit.
+ */
+void Transcript::Absorb(const std::string &tag, const CryptoPP::Integer &x,
+                        size_t width) {
+  if (x.IsNegative() || x.ByteCount() > width) {
+    throw std::invalid_argument("transcript value out of range: " + tag);
+  }
+  this->AbsorbLabel(tag);
+  std::vector<CryptoPP::byte> data;
+  put_uint64(width, data);
+  data.resize(data.size() + width);
+  x.Encode(data.data() + data.size() - width, width);
+  this->hash.Update(data.data(), data.size());
+}
+
+/**
+ * Absorb a length-prefixed label.
+ */
+void Transcript::AbsorbLabel(const std::string &label) {
+  std::vector<CryptoPP::byte> data;
+  put_uint64(label.size(), data);
+  data.insert(data.end(), label.begin(), label.end());
+  this->hash.Update(data.data(), data.size());
+}
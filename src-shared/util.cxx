@@ -129,50 +129,3 @@ std::vector<std::string> string_split(std::string str, char delimiter) {
   }
   return result;
 }
-
-/**
- * Hash vote zkp
- */
-CryptoPP::Integer hash_vote_zkp(CryptoPP::Integer pk, CryptoPP::Integer a,
-                                CryptoPP::Integer b, CryptoPP::Integer a0_p,
-                                CryptoPP::Integer b0_p, CryptoPP::Integer a1_p,
-                                CryptoPP::Integer b1_p) {
-  std::string res;
-  res += CryptoPP::IntToString(pk);
-  res += CryptoPP::IntToString(a);
-  res += CryptoPP::IntToString(b);
-  res += CryptoPP::IntToString(a0_p);
-  res += CryptoPP::IntToString(b0_p);
-  res += CryptoPP::IntToString(a1_p);
-  res += CryptoPP::IntToString(b1_p);
-
-  CryptoPP::SHA256 hash;
-  std::string encodedHex;
-  CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(encodedHex));
-  CryptoPP::StringSource(
-      res, true,
-      new CryptoPP::HashFilter(hash, new CryptoPP::StringSink(encodedHex)));
-  return CryptoPP::Integer(("0x" + encodedHex).c_str());
-}
-
-/**
- * Hash partial decryption zkp
- */
-CryptoPP::Integer hash_dec_zkp(CryptoPP::Integer pk, CryptoPP::Integer a,
-                               CryptoPP::Integer b, CryptoPP::Integer u,
-                               CryptoPP::Integer v) {
-  std::string res;
-  res += CryptoPP::IntToString(pk);
-  res += CryptoPP::IntToString(a);
-  res += CryptoPP::IntToString(b);
-  res += CryptoPP::IntToString(u);
-  res += CryptoPP::IntToString(v);
-
-  CryptoPP::SHA256 hash;
-  std::string encodedHex;
-  CryptoPP::HexEncoder encoder(new CryptoPP::StringSink(encodedHex));
-  CryptoPP::StringSource(
-      res, true,
-      new CryptoPP::HashFilter(hash, new CryptoPP::StringSink(encodedHex)));
-  return CryptoPP::Integer(("0x" + encodedHex).c_str());
-}
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../../include-shared/config.hpp"
+#include "../../include-shared/group.hpp"
 #include "../../include-shared/logger.hpp"
 #include "../../include/pkg/arbiter.hpp"
 
@@ -25,6 +26,7 @@ int main(int argc, char *argv[]) {
   // Create arbiter object and run
   ArbiterConfig arbiter_config = load_arbiter_config(argv[1]);
   CommonConfig common_config = load_common_config(argv[2]);
+  SetElectionGroup(common_config.group);
   ArbiterClient arbiter = ArbiterClient(arbiter_config, common_config);
   arbiter.run();
   return 0;
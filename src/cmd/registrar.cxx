@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../../include-shared/config.hpp"
+#include "../../include-shared/group.hpp"
 #include "../../include-shared/logger.hpp"
 #include "../../include/pkg/registrar.hpp"
 
@@ -26,6 +27,7 @@ int main(int argc, char *argv[]) {
   // Create registrar object and run
   RegistrarConfig registrar_config = load_registrar_config(argv[2]);
   CommonConfig common_config = load_common_config(argv[3]);
+  SetElectionGroup(common_config.group);
   RegistrarClient registrar = RegistrarClient(registrar_config, common_config);
   registrar.run(port);
   return 0;
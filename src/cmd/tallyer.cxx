@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../../include-shared/config.hpp"
+#include "../../include-shared/group.hpp"
 #include "../../include-shared/logger.hpp"
 #include "../../include/pkg/tallyer.hpp"
 
@@ -26,6 +27,7 @@ int main(int argc, char *argv[]) {
   // Create tallyer object and run
   TallyerConfig tallyer_config = load_tallyer_config(argv[2]);
   CommonConfig common_config = load_common_config(argv[3]);
+  SetElectionGroup(common_config.group);
   TallyerClient tallyer = TallyerClient(tallyer_config, common_config);
   tallyer.run(port);
   return 0;
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "../../include-shared/config.hpp"
+#include "../../include-shared/group.hpp"
 #include "../../include-shared/logger.hpp"
 #include "../../include/pkg/voter.hpp"
 
@@ -30,6 +31,7 @@ int main(int argc, char *argv[]) {
   // Create voter object and run
   VoterConfig voter_config = load_voter_config(argv[1]);
   CommonConfig common_config = load_common_config(argv[2]);
+  SetElectionGroup(common_config.group);
   VoterClient voter =
       VoterClient(network_driver, crypto_driver, voter_config, common_config);
   voter.run();
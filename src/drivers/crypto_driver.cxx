@@ -1,6 +1,14 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 
 #include "crypto++/base64.h"
 #include "crypto++/osrng.h"
@@ -13,18 +21,161 @@
 #include <crypto++/queue.h>
 
 #include "../../include-shared/constants.hpp"
+#include "../../include-shared/group.hpp"
+#include "../../include-shared/rng.hpp"
 #include "../../include-shared/util.hpp"
 #include "../../include/drivers/crypto_driver.hpp"
 
 using namespace CryptoPP;
 
+namespace {
+// AES-GCM framing: type byte, nonce, ciphertext, tag.
+const size_t GCM_NONCE_SIZE = 12;
+const size_t GCM_TAG_SIZE = 16;
+const size_t GCM_HEADER_SIZE = 1 + GCM_NONCE_SIZE;
+
+// Hashing in RSA_BLIND_verify_batch is split across cores, but no chunk
+// smaller than this.
+const size_t BLIND_HASH_MIN_CHUNK = 64;
+
+// Handles the key-based RSA overloads keep; the cache is emptied when it
+// reaches this many keys.
+const size_t RSA_HANDLE_CACHE_SIZE = 16;
+
+/**
+ * The handle for key, built on its first use and then shared. Keys are told
+ * apart by modulus and exponent.
+ */
+template <typename Handle, typename Key>
+std::shared_ptr<const Handle> cached_handle(const Key &key,
+                                            const CryptoPP::Integer &exponent) {
+  static std::mutex mtx;
+  static std::map<std::pair<CryptoPP::Integer, CryptoPP::Integer>,
+                  std::shared_ptr<const Handle>>
+      handles;
+  std::pair<CryptoPP::Integer, CryptoPP::Integer> id(key.GetModulus(),
+                                                     exponent);
+  {
+    std::unique_lock<std::mutex> lck(mtx);
+    auto it = handles.find(id);
+    if (it != handles.end()) {
+      return it->second;
+    }
+  }
+  std::shared_ptr<const Handle> handle = std::make_shared<const Handle>(key);
+  std::unique_lock<std::mutex> lck(mtx);
+  if (handles.size() >= RSA_HANDLE_CACHE_SIZE) {
+    handles.clear();
+  }
+  handles.emplace(id, handle);
+  return handle;
+}
+
+std::shared_ptr<const RSASignerHandle>
+cached_signer(const RSA::PrivateKey &key) {
+  return cached_handle<RSASignerHandle>(key, key.GetPrivateExponent());
+}
+
+std::shared_ptr<const RSAVerifierHandle>
+cached_verifier(const RSA::PublicKey &key) {
+  return cached_handle<RSAVerifierHandle>(key, key.GetPublicExponent());
+}
+
+// Exponent width for the randomized screen in RSA_BLIND_verify_batch. A
+// range holding a bad pair passes one screen with probability about
+// 2^-BLIND_SCREEN_BITS.
+const unsigned int BLIND_SCREEN_BITS = 64;
+
+/**
+ * Check s_i^e == h_i for every i in indices, MODEXP_LANES at a time.
+ */
+void blind_verify_each(const RSAVerifierHandle &verifier,
+                       const std::vector<CryptoPP::Integer> &hashes,
+                       std::span<const CryptoPP::Integer> signatures,
+                       std::span<const size_t> indices,
+                       std::vector<bool> &valid) {
+  std::vector<CryptoPP::Integer> batch;
+  batch.reserve(indices.size());
+  for (size_t i : indices) {
+    batch.push_back(signatures[i]);
+  }
+  std::vector<CryptoPP::Integer> applied = verifier.ApplyFunctionBatch(batch);
+  for (size_t k = 0; k < indices.size(); k++) {
+    valid[indices[k]] = applied[k] == hashes[indices[k]];
+  }
+}
+
+/**
+ * Screen the pairs in indices with fresh random exponents r_i of
+ * BLIND_SCREEN_BITS bits: (prod s_i^r_i)^e == prod h_i^r_i. A range that
+ * fails is bisected, each half with new exponents, until it fits in one
+ * pass of the lane kernel; then its pairs are checked one by one.
+ */
+void blind_screen_range(const RSAVerifierHandle &verifier,
+                        const std::vector<CryptoPP::Integer> &hashes,
+                        std::span<const CryptoPP::Integer> signatures,
+                        std::span<const size_t> indices,
+                        std::vector<bool> &valid) {
+  if (indices.empty()) {
+    return;
+  }
+  const CryptoPP::Integer &n = verifier.GetModulus();
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  const CryptoPP::Integer r_min =
+      CryptoPP::Integer::Power2(BLIND_SCREEN_BITS - 1);
+  const CryptoPP::Integer r_max =
+      CryptoPP::Integer::Power2(BLIND_SCREEN_BITS) - 1;
+  std::vector<CryptoPP::Integer> s(indices.size()), h(indices.size()),
+      r(indices.size());
+  for (size_t k = 0; k < indices.size(); k++) {
+    s[k] = signatures[indices[k]];
+    h[k] = hashes[indices[k]];
+    r[k].Randomize(rng, r_min, r_max);
+  }
+  if (verifier.ApplyFunction(MultiExponentiate(s, r, n)) ==
+      MultiExponentiate(h, r, n)) {
+    for (size_t i : indices) {
+      valid[i] = true;
+    }
+    return;
+  }
+  if (indices.size() <= MODEXP_LANES) {
+    blind_verify_each(verifier, hashes, signatures, indices, valid);
+    return;
+  }
+  size_t mid = indices.size() / 2;
+  blind_screen_range(verifier, hashes, signatures, indices.first(mid), valid);
+  blind_screen_range(verifier, hashes, signatures, indices.subspan(mid),
+                     valid);
+}
+} // namespace
+
+/**
+ * @brief Sets the channel mode agreed in the key exchange.
+ */
+void CryptoDriver::set_channel_mode(ChannelMode::T mode) {
+  this->channel_mode = mode;
+}
+
+/**
+ * @brief Gets the channel mode.
+ */
+ChannelMode::T CryptoDriver::get_channel_mode() const {
+  return this->channel_mode;
+}
+
 /**
  * @brief Encrypts the given message using AES and tags the ciphertext with an
- * HMAC. Outputs an HMACTagged_Wrapper as bytes.
+ * HMAC. Outputs an HMACTagged_Wrapper as bytes. In AES-GCM mode, outputs
+ * an AEAD_encrypt frame instead.
  */
 std::vector<unsigned char>
 CryptoDriver::encrypt_and_tag(SecByteBlock AES_key, SecByteBlock HMAC_key,
                               Serializable *message) {
+  if (this->channel_mode == ChannelMode::AES_GCM) {
+    return this->AEAD_encrypt(AES_key, message);
+  }
+
   // Serialize given message.
   std::vector<unsigned char> plaintext;
   message->serialize(plaintext);
@@ -55,6 +206,10 @@ CryptoDriver::encrypt_and_tag(SecByteBlock AES_key, SecByteBlock HMAC_key,
 std::pair<std::vector<unsigned char>, bool>
 CryptoDriver::decrypt_and_verify(SecByteBlock AES_key, SecByteBlock HMAC_key,
                                  std::vector<unsigned char> ciphertext_data) {
+  if (this->channel_mode == ChannelMode::AES_GCM) {
+    return this->AEAD_decrypt(AES_key, std::move(ciphertext_data));
+  }
+
   // Deserialize
   HMACTagged_Wrapper ciphertext;
   ciphertext.deserialize(ciphertext_data);
@@ -72,12 +227,81 @@ CryptoDriver::decrypt_and_verify(SecByteBlock AES_key, SecByteBlock HMAC_key,
   return std::make_pair(plaintext_data, valid);
 }
 
+/**
+ * @brief Encrypts and authenticates the given message with AES-GCM in one
+ * pass. The message is serialized straight into the output frame
+ * (type byte || nonce || ciphertext || tag) and encrypted in place; the
+ * type byte is authenticated as associated data.
+ */
+std::vector<unsigned char> CryptoDriver::AEAD_encrypt(SecByteBlock key,
+                                                      Serializable *message) {
+  std::vector<unsigned char> data;
+  data.reserve(GCM_HEADER_SIZE + message->serialized_size() + GCM_TAG_SIZE);
+  data.push_back((char)MessageType::AEADTagged_Wrapper);
+  data.resize(GCM_HEADER_SIZE);
+  message->write(data);
+  size_t length = data.size() - GCM_HEADER_SIZE;
+  data.resize(data.size() + GCM_TAG_SIZE);
+
+  try {
+    RandomNumberGenerator &prng = ThreadRNG();
+    prng.GenerateBlock(&data[1], GCM_NONCE_SIZE);
+
+    GCM<AES>::Encryption encryptor;
+    encryptor.SetKey(key, key.size());
+    unsigned char *payload = data.data() + GCM_HEADER_SIZE;
+    encryptor.EncryptAndAuthenticate(payload, payload + length, GCM_TAG_SIZE,
+                                     &data[1], GCM_NONCE_SIZE, data.data(), 1,
+                                     payload, length);
+  } catch (CryptoPP::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    throw std::runtime_error("CryptoDriver AES-GCM encryption failed.");
+  }
+  return data;
+}
+
+/**
+ * @brief Verifies and decrypts an AEAD_encrypt frame in place. Returns the
+ * serialized message, or an empty vector and false if the frame is
+ * malformed or fails authentication.
+ */
+std::pair<std::vector<unsigned char>, bool>
+CryptoDriver::AEAD_decrypt(SecByteBlock key,
+                           std::vector<unsigned char> ciphertext_data) {
+  std::vector<unsigned char> &data = ciphertext_data;
+  if (data.size() < GCM_HEADER_SIZE + GCM_TAG_SIZE ||
+      data[0] != MessageType::AEADTagged_Wrapper) {
+    return std::make_pair(std::vector<unsigned char>(), false);
+  }
+  size_t length = data.size() - GCM_HEADER_SIZE - GCM_TAG_SIZE;
+
+  bool valid;
+  try {
+    GCM<AES>::Decryption decryptor;
+    decryptor.SetKey(key, key.size());
+    unsigned char *payload = data.data() + GCM_HEADER_SIZE;
+    valid = decryptor.DecryptAndVerify(payload, payload + length, GCM_TAG_SIZE,
+                                       &data[1], GCM_NONCE_SIZE, data.data(),
+                                       1, payload, length);
+  } catch (CryptoPP::Exception &e) {
+    std::cerr << e.what() << std::endl;
+    throw std::runtime_error("CryptoDriver AES-GCM decryption failed.");
+  }
+  if (!valid) {
+    return std::make_pair(std::vector<unsigned char>(), false);
+  }
+
+  data.resize(GCM_HEADER_SIZE + length);
+  data.erase(data.begin(), data.begin() + GCM_HEADER_SIZE);
+  return std::make_pair(std::move(data), true);
+}
+
 /**
  * @brief Generate DH keypair.
  */
 std::tuple<DH, SecByteBlock, SecByteBlock> CryptoDriver::DH_initialize() {
   DH DH_obj(DL_P, DL_Q, DL_G);
-  AutoSeededRandomPool prng;
+  RandomNumberGenerator &prng = ThreadRNG();
   SecByteBlock DH_private_key(DH_obj.PrivateKeyLength());
   SecByteBlock DH_public_key(DH_obj.PublicKeyLength());
   DH_obj.GenerateKeyPair(prng, DH_private_key, DH_public_key);
@@ -123,7 +347,7 @@ CryptoDriver::AES_encrypt(SecByteBlock key, std::string plaintext) {
     CBC_Mode<AES>::Encryption AES_encryptor = CBC_Mode<AES>::Encryption();
 
     SecByteBlock iv(AES::BLOCKSIZE);
-    AutoSeededRandomPool prng;
+    RandomNumberGenerator &prng = ThreadRNG();
     AES_encryptor.GetNextIV(prng, iv.BytePtr());
     AES_encryptor.SetKeyWithIV(key, key.size(), iv);
 
@@ -181,6 +405,196 @@ CryptoDriver::HMAC_generate_key(const SecByteBlock &DH_shared_key) {
   return HMAC_shared_key;
 }
 
+/**
+ * @brief Generates the resumption secret of a session using HKDF with a
+ * salt. Both ends derive it from the DH shared key; the server seals it into
+ * the session ticket.
+ */
+SecByteBlock
+CryptoDriver::SESSION_generate_secret(const SecByteBlock &DH_shared_key) {
+  std::string session_salt_str("salt0002");
+  SecByteBlock session_salt((const unsigned char *)(session_salt_str.data()),
+                            session_salt_str.size());
+  HKDF<SHA256> hkdf;
+  SecByteBlock secret(SHA256::DIGESTSIZE);
+  hkdf.DeriveKey(secret, secret.size(), DH_shared_key, DH_shared_key.size(),
+                 session_salt, session_salt.size(), NULL, 0);
+  return secret;
+}
+
+/**
+ * @brief Generates a random AES-256 key for sealing session tickets. It
+ * never leaves the server.
+ */
+SecByteBlock CryptoDriver::SESSION_generate_ticket_key() {
+  SecByteBlock key(AES::MAX_KEYLENGTH);
+  ThreadRNG().GenerateBlock(key, key.size());
+  return key;
+}
+
+/**
+ * @brief Generates a fresh nonce for a resumption.
+ */
+SecByteBlock CryptoDriver::SESSION_generate_nonce() {
+  SecByteBlock nonce(SESSION_NONCE_SIZE);
+  ThreadRNG().GenerateBlock(nonce, nonce.size());
+  return nonce;
+}
+
+/**
+ * @brief Seals secret into a ticket that expires after lifetime seconds.
+ * The ticket is nonce || AES-GCM(expiry || secret) || tag under ticket_key.
+ */
+std::string CryptoDriver::SESSION_seal_ticket(const SecByteBlock &ticket_key,
+                                              const SecByteBlock &secret,
+                                              int lifetime) {
+  uint64_t expiry = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count() +
+                    lifetime;
+  std::string ticket(GCM_NONCE_SIZE + 8 + secret.size() + GCM_TAG_SIZE, '\0');
+  byte *nonce = (byte *)&ticket[0];
+  byte *payload = nonce + GCM_NONCE_SIZE;
+  for (int i = 0; i < 8; i++) {
+    payload[i] = (byte)(expiry >> (8 * (7 - i)));
+  }
+  std::memcpy(payload + 8, secret.data(), secret.size());
+  size_t length = 8 + secret.size();
+
+  ThreadRNG().GenerateBlock(nonce, GCM_NONCE_SIZE);
+  GCM<AES>::Encryption encryptor;
+  encryptor.SetKey(ticket_key, ticket_key.size());
+  encryptor.EncryptAndAuthenticate(payload, payload + length, GCM_TAG_SIZE,
+                                   nonce, GCM_NONCE_SIZE, NULL, 0, payload,
+                                   length);
+  return ticket;
+}
+
+/**
+ * @brief Opens a ticket sealed with SESSION_seal_ticket. Returns the secret,
+ * or false if the ticket was not sealed under ticket_key or has expired.
+ */
+std::pair<SecByteBlock, bool>
+CryptoDriver::SESSION_open_ticket(const SecByteBlock &ticket_key,
+                                  const std::string &ticket) {
+  if (ticket.size() < GCM_NONCE_SIZE + 8 + GCM_TAG_SIZE) {
+    return std::make_pair(SecByteBlock(), false);
+  }
+  std::string data = ticket;
+  byte *nonce = (byte *)&data[0];
+  byte *payload = nonce + GCM_NONCE_SIZE;
+  size_t length = data.size() - GCM_NONCE_SIZE - GCM_TAG_SIZE;
+
+  GCM<AES>::Decryption decryptor;
+  decryptor.SetKey(ticket_key, ticket_key.size());
+  if (!decryptor.DecryptAndVerify(payload, payload + length, GCM_TAG_SIZE,
+                                  nonce, GCM_NONCE_SIZE, NULL, 0, payload,
+                                  length)) {
+    return std::make_pair(SecByteBlock(), false);
+  }
+
+  uint64_t expiry = 0;
+  for (int i = 0; i < 8; i++) {
+    expiry = (expiry << 8) | payload[i];
+  }
+  uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::system_clock::now().time_since_epoch())
+                     .count();
+  if (now >= expiry) {
+    return std::make_pair(SecByteBlock(), false);
+  }
+  return std::make_pair(SecByteBlock(payload + 8, length - 8), true);
+}
+
+/**
+ * @brief Answers a request to resume the session a ticket was issued for.
+ * Opens the ticket with ticket_key; if it is ours and unexpired, derives
+ * fresh keys from its secret and both nonces, chooses the channel mode
+ * (AES-GCM only if requested and allow_aead) and switches this driver to
+ * it. Returns the reply to send, which declines the request otherwise, and
+ * the AES and HMAC keys if it was accepted.
+ */
+std::pair<ServerToUser_Resume_Message, std::pair<SecByteBlock, SecByteBlock>>
+CryptoDriver::SESSION_resume(const SecByteBlock &ticket_key,
+                             const UserToServer_Resume_Message &resume,
+                             bool allow_aead) {
+  std::pair<SecByteBlock, bool> secret(SecByteBlock(), false);
+  if (resume.client_nonce.size() == SESSION_NONCE_SIZE) {
+    secret = this->SESSION_open_ticket(ticket_key, resume.session_ticket);
+  }
+
+  ServerToUser_Resume_Message reply;
+  reply.accepted = secret.second;
+  std::pair<SecByteBlock, SecByteBlock> keys;
+  if (reply.accepted) {
+    reply.server_nonce = this->SESSION_generate_nonce();
+    reply.channel_mode =
+        resume.channel_mode == ChannelMode::AES_GCM && allow_aead
+            ? ChannelMode::AES_GCM
+            : ChannelMode::CBC_HMAC;
+    keys = this->SESSION_derive_keys(secret.first, resume.client_nonce,
+                                     reply.server_nonce);
+    reply.server_confirmation = this->SESSION_confirmation(
+        keys.second, resume.client_nonce, reply.server_nonce,
+        reply.channel_mode);
+    this->set_channel_mode(reply.channel_mode);
+  }
+  return std::make_pair(reply, keys);
+}
+
+/**
+ * @brief Derives fresh AES and HMAC keys for a resumed session from the
+ * resumption secret and both nonces.
+ */
+std::pair<SecByteBlock, SecByteBlock>
+CryptoDriver::SESSION_derive_keys(const SecByteBlock &secret,
+                                  const SecByteBlock &client_nonce,
+                                  const SecByteBlock &server_nonce) {
+  SecByteBlock salt(client_nonce.size() + server_nonce.size());
+  std::memcpy(salt.data(), client_nonce.data(), client_nonce.size());
+  std::memcpy(salt.data() + client_nonce.size(), server_nonce.data(),
+              server_nonce.size());
+
+  std::string aes_info("resume-aes");
+  std::string hmac_info("resume-hmac");
+  HKDF<SHA256> hkdf;
+  SecByteBlock AES_key(AES::DEFAULT_KEYLENGTH);
+  hkdf.DeriveKey(AES_key, AES_key.size(), secret, secret.size(), salt,
+                 salt.size(), (const byte *)aes_info.data(), aes_info.size());
+  SecByteBlock HMAC_key(SHA256::BLOCKSIZE);
+  hkdf.DeriveKey(HMAC_key, HMAC_key.size(), secret, secret.size(), salt,
+                 salt.size(), (const byte *)hmac_info.data(),
+                 hmac_info.size());
+  return std::make_pair(AES_key, HMAC_key);
+}
+
+/**
+ * @brief The server's proof that it opened the ticket: an HMAC under the
+ * resumed session's HMAC key on both nonces and the chosen channel mode.
+ */
+std::string CryptoDriver::SESSION_confirmation(SecByteBlock HMAC_key,
+                                               const SecByteBlock &client_nonce,
+                                               const SecByteBlock &server_nonce,
+                                               ChannelMode::T mode) {
+  return this->HMAC_generate(HMAC_key, byteblock_to_string(client_nonce) +
+                                           byteblock_to_string(server_nonce) +
+                                           std::string(1, (char)mode));
+}
+
+/**
+ * @brief Verifies a confirmation made with SESSION_confirmation.
+ */
+bool CryptoDriver::SESSION_verify_confirmation(
+    SecByteBlock HMAC_key, const SecByteBlock &client_nonce,
+    const SecByteBlock &server_nonce, ChannelMode::T mode,
+    const std::string &confirmation) {
+  return this->HMAC_verify(HMAC_key,
+                           byteblock_to_string(client_nonce) +
+                               byteblock_to_string(server_nonce) +
+                               std::string(1, (char)mode),
+                           confirmation);
+}
+
 /**
  * @brief Given a ciphertext, generates an HMAC
  */
@@ -218,21 +632,20 @@ bool CryptoDriver::HMAC_verify(SecByteBlock key, std::string ciphertext,
 
 /**
  * @brief Generates a pair of El Gamal keys. This function should:
- * 1) Generate a random `a` value using an CryptoPP::AutoSeededRandomPool
+ * 1) Generate a random `a` value using the thread's generator (ThreadRNG)
       from the range (1, q-1].
- * 2) Exponentiate the base DL_G to get the public value,
+ * 2) Exponentiate the election group generator to get the public value,
  *    then return (private key, public key)
  */
 std::pair<CryptoPP::Integer, CryptoPP::Integer> CryptoDriver::EG_generate() {
   // TODO: implement me!
-    CryptoPP::AutoSeededRandomPool rng;
-    // These values should be defined according to your cryptographic parameters
+    CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+    std::shared_ptr<const Group> group = ElectionGroup();
+    // Secret key in [1, q), public key g^a in the election group
     CryptoPP::Integer a;
-    do {
-        a.Randomize(rng, 2, DL_P - 2); // Generates a random number in the range [2, p-2]
-    } while (a <= 1 || a >= DL_P-1);
-    
-    CryptoPP::Integer A = ModularExponentiation(DL_G, a % DL_Q, DL_P);
+    a.Randomize(rng, 1, group->Order() - 1);
+
+    CryptoPP::Integer A = group->ExpGenerator(a);
     return {a, A};
 }
 
@@ -242,8 +655,8 @@ std::pair<CryptoPP::Integer, CryptoPP::Integer> CryptoDriver::EG_generate() {
  */
 std::pair<RSA::PrivateKey, RSA::PublicKey> CryptoDriver::RSA_generate_keys() {
   // TODO: implement me!
-  // Create an AutoSeededRandomPool object to generate random numbers
-    CryptoPP::AutoSeededRandomPool rng;
+  // Use this thread's generator for random numbers
+    CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
 
     // Instantiate a PrivateKey and PublicKey object
     CryptoPP::RSA::PrivateKey privateKey;
@@ -259,31 +672,149 @@ std::pair<RSA::PrivateKey, RSA::PublicKey> CryptoDriver::RSA_generate_keys() {
     return {privateKey, publicKey};
 }
 
+/**
+ * @brief Prepare the PSS signer and CRT components for signing_key. Keys
+ * without CRT components fall back to the full private exponent.
+ */
+RSASignerHandle::RSASignerHandle(const RSA::PrivateKey &signing_key)
+    : signer(signing_key), n(signing_key.GetModulus()),
+      e(signing_key.GetPublicExponent()),
+      d(signing_key.GetPrivateExponent()), p(signing_key.GetPrime1()),
+      q(signing_key.GetPrime2()), dp(signing_key.GetModPrime1PrivateExponent()),
+      dq(signing_key.GetModPrime2PrivateExponent()),
+      q_inv(signing_key.GetMultiplicativeInverseOfPrime2ModPrime1()) {
+  this->has_crt = !this->p.IsZero() && !this->q.IsZero() &&
+                  this->p * this->q == this->n;
+}
+
+/**
+ * @brief PSS-SHA256 signature on message.
+ */
+std::string RSASignerHandle::Sign(std::span<const unsigned char> message) const {
+  RandomNumberGenerator &rng = ThreadRNG();
+  std::string signature(this->signer.MaxSignatureLength(), '\0');
+  size_t length = this->signer.SignMessage(
+      rng, message.data(), message.size(), (byte *)signature.data());
+  signature.resize(length);
+  return signature;
+}
+
+/**
+ * @brief Raw RSA signature blinded_msg^d mod n, computed as two half-size
+ * exponentiations mod p and q recombined with Garner's formula. The result
+ * is checked with the public exponent before it is released, since a fault
+ * in either half would reveal a factor of n; throws if the check fails.
+ */
+CryptoPP::Integer
+RSASignerHandle::BlindSign(const CryptoPP::Integer &blinded_msg) const {
+  CryptoPP::Integer c = blinded_msg % this->n;
+  if (!this->has_crt) {
+    return CryptoPP::ModularExponentiation(c, this->d, this->n);
+  }
+
+  CryptoPP::Integer s_p = CryptoPP::ModularExponentiation(c % this->p, this->dp, this->p);
+  CryptoPP::Integer s_q = CryptoPP::ModularExponentiation(c % this->q, this->dq, this->q);
+  // s = s_q + q * (q^-1 * (s_p - s_q) mod p)
+  CryptoPP::Integer h = a_times_b_mod_c(this->q_inv, (s_p - s_q) % this->p, this->p);
+  CryptoPP::Integer s = s_q + this->q * h;
+
+  if (CryptoPP::ModularExponentiation(s, this->e, this->n) != c) {
+    throw std::runtime_error("RSA blind signature failed verification");
+  }
+  return s;
+}
+
 /**
  * @brief Sign the given message with the given signing key.
  */
 std::string CryptoDriver::RSA_sign(const RSA::PrivateKey &signing_key,
                                    std::vector<unsigned char> message) {
-  // TODO: implement me!
-       // Initialize RNG
-    AutoSeededRandomPool rng;
+  return this->RSA_sign(*cached_signer(signing_key), message);
+}
+
+/**
+ * @brief Sign the given message with a prepared signer.
+ */
+std::string CryptoDriver::RSA_sign(const RSASignerHandle &signer,
+                                   std::span<const unsigned char> message) {
+  return signer.Sign(message);
+}
+
+/**
+ * @brief Prepare the PSS verifier and a Montgomery context for n.
+ */
+RSAVerifierHandle::RSAVerifierHandle(const RSA::PublicKey &verification_key)
+    : verifier(verification_key), n(verification_key.GetModulus()),
+      e(verification_key.GetPublicExponent()) {
+  if (this->n.IsOdd()) {
+    this->n_context = std::make_unique<MontgomeryContext>(this->n);
+  }
+  this->screen_batches =
+      this->n_context && this->e.BitCount() > BLIND_SCREEN_BITS &&
+      CryptoPP::Jacobi(this->n - 1, this->n) == -1;
+}
 
-    // Initialize the signer with the RSA private key
-    RSASS<PSS, SHA256>::Signer signer(signing_key);
+/**
+ * @brief Verify a PSS-SHA256 signature without copying either buffer.
+ */
+bool RSAVerifierHandle::Verify(std::span<const unsigned char> message,
+                               std::span<const unsigned char> signature) const {
+  return this->verifier.VerifyMessage(message.data(), message.size(),
+                                      signature.data(), signature.size());
+}
 
-    // Convert vector<unsigned char> to string
-    std::string messageStr = chvec2str(message);
+/**
+ * @brief x^e mod n, square-and-multiply in Montgomery form.
+ */
+CryptoPP::Integer
+RSAVerifierHandle::ApplyFunction(const CryptoPP::Integer &x) const {
+  if (!this->n_context) {
+    return CryptoPP::ModularExponentiation(x, this->e, this->n);
+  }
+  const MontgomeryContext &context = *this->n_context;
+  CryptoPP::Integer base = context.ConvertIn(x);
+  CryptoPP::Integer result = base;
+  for (int i = (int)this->e.BitCount() - 2; i >= 0; i--) {
+    result = context.Square(result);
+    if (this->e.GetBit(i)) {
+      result = context.Multiply(result, base);
+    }
+  }
+  return context.ConvertOut(result);
+}
 
-    std::string signature;
+/**
+ * @brief x^e mod n for every x, MODEXP_LANES at a time.
+ */
+std::vector<CryptoPP::Integer> RSAVerifierHandle::ApplyFunctionBatch(
+    const std::vector<CryptoPP::Integer> &xs) const {
+  if (!this->n_context) {
+    std::vector<CryptoPP::Integer> ys;
+    for (const CryptoPP::Integer &x : xs) {
+      ys.push_back(this->ApplyFunction(x));
+    }
+    return ys;
+  }
+  return BatchExponentiate(
+      xs, std::vector<CryptoPP::Integer>(xs.size(), this->e), this->n);
+}
 
-    // Sign the message
-    StringSource ss(messageStr, true,
-                    new SignerFilter(rng, signer,
-                                     new StringSink(signature)
-                    ) // SignerFilter
-    ); // StringSource
+/**
+ * @brief Whether RSA_BLIND_verify_batch may screen pairs together under this
+ * key. The screen proves s_i^e == h_i only up to an element of order two,
+ * and of those only -1 can be produced without factoring n; it is ruled
+ * out per pair by a Jacobi symbol, which needs Jacobi(-1, n) == -1. The
+ * screen also only saves work when e is wider than its exponents.
+ */
+bool RSAVerifierHandle::CanScreenBatches() const {
+  return this->screen_batches;
+}
 
-    return signature;
+/**
+ * @brief The modulus n.
+ */
+const CryptoPP::Integer &RSAVerifierHandle::GetModulus() const {
+  return this->n;
 }
 
 /**
@@ -292,25 +823,19 @@ std::string CryptoDriver::RSA_sign(const RSA::PrivateKey &signing_key,
 bool CryptoDriver::RSA_verify(const RSA::PublicKey &verification_key,
                               std::vector<unsigned char> message,
                               std::string signature) {
-  const int flags = SignatureVerificationFilter::PUT_RESULT |
-                    SignatureVerificationFilter::SIGNATURE_AT_END;
-  // TODO: implement me!
-    std::string messageStr = chvec2str(message);
-
-    // Initialize the verifier with the RSA public key
-    RSASS<PSS, SHA256>::Verifier verifier(verification_key);
-
-    bool result = false;
-
-    // Concatenate message and signature, then verify
-    StringSource ss(messageStr + signature, true,
-                    new SignatureVerificationFilter(verifier,
-                        new ArraySink((byte*)&result, sizeof(result)),
-                        flags
-                    ) // SignatureVerificationFilter
-    ); // StringSource
+  return this->RSA_verify(*cached_verifier(verification_key), message,
+                          signature);
+}
 
-    return result;
+/**
+ * @brief Verify that signature is valid on message with a prepared verifier.
+ */
+bool CryptoDriver::RSA_verify(const RSAVerifierHandle &verifier,
+                              std::span<const unsigned char> message,
+                              const std::string &signature) {
+  return verifier.Verify(
+      message, std::span<const unsigned char>(
+                   (const unsigned char *)signature.data(), signature.size()));
 }
 
 /**
@@ -320,7 +845,7 @@ std::pair<CryptoPP::Integer, CryptoPP::Integer>
 CryptoDriver::RSA_BLIND_blind(const RSA::PublicKey &public_key,
                               Serializable &msg) {
   // Convenience
-  CryptoPP::AutoSeededRandomPool prng;
+  CryptoPP::RandomNumberGenerator &prng = ThreadRNG();
   const CryptoPP::Integer n = public_key.GetModulus();
   const CryptoPP::Integer e = public_key.GetPublicExponent();
   const size_t SIG_SIZE = n.ByteCount();
@@ -364,15 +889,16 @@ CryptoDriver::RSA_BLIND_blind(const RSA::PublicKey &public_key,
 CryptoPP::Integer
 CryptoDriver::RSA_BLIND_sign(const RSA::PrivateKey &private_key,
                              CryptoPP::Integer blinded_msg) {
-  // TODO: implement me!
-    // Retrieve private key components
-    const CryptoPP::Integer& n = private_key.GetModulus();
-    const CryptoPP::Integer& d = private_key.GetPrivateExponent();
-
-    // Perform the signing operation: (blinded_msg^d) mod n
-    CryptoPP::Integer signed_blinded_msg = CryptoPP::ModularExponentiation(blinded_msg, d, n);
+  return this->RSA_BLIND_sign(*cached_signer(private_key), blinded_msg);
+}
 
-    return signed_blinded_msg;
+/**
+ * @brief Signs the given blinded message with a prepared signer.
+ */
+CryptoPP::Integer
+CryptoDriver::RSA_BLIND_sign(const RSASignerHandle &signer,
+                             CryptoPP::Integer blinded_msg) {
+  return signer.BlindSign(blinded_msg);
 }
 
 /**
@@ -397,10 +923,18 @@ CryptoDriver::RSA_BLIND_unblind(const RSA::PublicKey &public_key,
 bool CryptoDriver::RSA_BLIND_verify(const RSA::PublicKey &public_key,
                                     Serializable &msg,
                                     CryptoPP::Integer signature) {
+  return this->RSA_BLIND_verify(*cached_verifier(public_key), msg, signature);
+}
+
+/**
+ * @brief Verifies the given signature with a prepared verifier.
+ */
+bool CryptoDriver::RSA_BLIND_verify(const RSAVerifierHandle &verifier,
+                                    Serializable &msg,
+                                    const CryptoPP::Integer &signature) {
   // Convenience
-  const size_t SIG_SIZE = public_key.GetModulus().ByteCount();
-  const CryptoPP::Integer n = public_key.GetModulus();
-  const CryptoPP::Integer e = public_key.GetPublicExponent();
+  const CryptoPP::Integer &n = verifier.GetModulus();
+  const size_t SIG_SIZE = n.ByteCount();
 
   // Convert the msg to a secbyteblock
   std::vector<unsigned char> msg_buff;
@@ -421,11 +955,106 @@ bool CryptoDriver::RSA_BLIND_verify(const RSA::PublicKey &public_key,
   // 2) Compare the result to the hash of the message `hm` and return
   // TODO: implement me!
 
+    if (!signature.IsPositive() || signature >= n) {
+        return false;
+    }
+
     //1) Raise the signature to the power of e modulo n.
-    CryptoPP::Integer m = CryptoPP::ModularExponentiation(signature, e, n);
+    CryptoPP::Integer m = verifier.ApplyFunction(signature);
     return hm == m;
 }
 
+/**
+ * @brief Verifies many blind signatures under one key and reports each pair
+ * on its own. Signatures outside [1, n) are rejected. When the key allows
+ * it (see RSAVerifierHandle::CanScreenBatches), distinct pairs go through a
+ * randomized screen that bisects down to individual checks on failure;
+ * repeated messages or signatures, and every pair under other keys, are
+ * checked individually.
+ */
+std::vector<bool> CryptoDriver::RSA_BLIND_verify_batch(
+    const RSA::PublicKey &public_key, const std::vector<Serializable *> &msgs,
+    std::span<const CryptoPP::Integer> signatures) {
+  return this->RSA_BLIND_verify_batch(*cached_verifier(public_key), msgs,
+                                      signatures);
+}
+
+/**
+ * @brief RSA_BLIND_verify_batch with a prepared verifier.
+ */
+std::vector<bool> CryptoDriver::RSA_BLIND_verify_batch(
+    const RSAVerifierHandle &verifier, const std::vector<Serializable *> &msgs,
+    std::span<const CryptoPP::Integer> signatures) {
+  if (msgs.size() != signatures.size()) {
+    throw std::invalid_argument("messages and signatures differ in length");
+  }
+  const CryptoPP::Integer &n = verifier.GetModulus();
+  const size_t SIG_SIZE = n.ByteCount();
+
+  // Hash every message; one chunk per core. Chunk 0 runs on this thread, so
+  // a batch of one chunk starts no threads at all.
+  std::vector<CryptoPP::Integer> hashes(msgs.size());
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t chunks = std::max<size_t>(
+      1, std::min<size_t>(threads, (msgs.size() + BLIND_HASH_MIN_CHUNK - 1) /
+                                       BLIND_HASH_MIN_CHUNK));
+  size_t chunk_size = (msgs.size() + chunks - 1) / chunks;
+  auto hash_chunk = [&](size_t c) {
+    size_t begin = c * chunk_size;
+    size_t end = std::min(msgs.size(), begin + chunk_size);
+    // One buffer per chunk, reused for every message in it.
+    std::vector<unsigned char> msg_buff;
+    for (size_t i = begin; i < end; i++) {
+      msg_buff.clear();
+      msgs[i]->serialize(msg_buff);
+      SecByteBlock hash = this->FDH_hash(
+          SecByteBlock(msg_buff.data(), msg_buff.size()), SIG_SIZE);
+      hashes[i] = CryptoPP::Integer(hash.data(), hash.size()) % n;
+    }
+  };
+  std::vector<std::future<void>> workers;
+  for (size_t c = 1; c < chunks; c++) {
+    workers.push_back(std::async(std::launch::async, hash_chunk, c));
+  }
+  hash_chunk(0);
+  for (std::future<void> &worker : workers) {
+    worker.get();
+  }
+
+  // Sort the pairs into ones checked individually and ones left to the
+  // screen. A screen ties pairs together, so repeats are kept out of it.
+  std::vector<bool> valid(msgs.size(), false);
+  bool screen = verifier.CanScreenBatches();
+  std::map<CryptoPP::Integer, size_t> hash_uses, signature_uses;
+  if (screen) {
+    for (size_t i = 0; i < msgs.size(); i++) {
+      hash_uses[hashes[i]]++;
+      signature_uses[signatures[i]]++;
+    }
+  }
+  std::vector<size_t> each, screened;
+  for (size_t i = 0; i < msgs.size(); i++) {
+    const CryptoPP::Integer &s = signatures[i];
+    if (!s.IsPositive() || s >= n) {
+      continue;
+    }
+    if (!screen || hash_uses[hashes[i]] > 1 || signature_uses[s] > 1) {
+      each.push_back(i);
+      continue;
+    }
+    // s^e == h forces equal Jacobi symbols (e is odd). As Jacobi(-1, n) is
+    // -1 here, this rejects -s, which the screen alone would miss half the
+    // time.
+    if (CryptoPP::Jacobi(s, n) != CryptoPP::Jacobi(hashes[i], n)) {
+      continue;
+    }
+    screened.push_back(i);
+  }
+  blind_verify_each(verifier, hashes, signatures, each, valid);
+  blind_screen_range(verifier, hashes, signatures, screened, valid);
+  return valid;
+}
+
 /**
  * @brief Uses HKDF to hash the given message to the desired domain size (in
  * bits)
@@ -441,4 +1070,71 @@ SecByteBlock CryptoDriver::FDH_hash(SecByteBlock input, int domain_byte_size) {
   SecByteBlock hash(domain_byte_size);
   hkdf.DeriveKey(hash, hash.size(), input, input.size(), NULL, 0, NULL, 0);
   return hash;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Starts the background thread if the pool has a size.
+ */
+DHKeyPool::DHKeyPool(size_t size, int refill_ms)
+    : size(size), refill_interval(refill_ms), stopping(false) {
+  if (this->size > 0) {
+    this->worker = std::thread(&DHKeyPool::Refill, this);
+  }
+}
+
+/**
+ * @brief Stops and joins the background thread.
+ */
+DHKeyPool::~DHKeyPool() {
+  {
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->stopping = true;
+  }
+  this->refill.notify_all();
+  if (this->worker.joinable()) {
+    this->worker.join();
+  }
+}
+
+/**
+ * @brief Takes a ready DH key pair, or generates one now if none is ready.
+ */
+std::tuple<DH, SecByteBlock, SecByteBlock> DHKeyPool::Pop() {
+  {
+    std::unique_lock<std::mutex> lck(this->mtx);
+    if (!this->pairs.empty()) {
+      auto dh_values = std::move(this->pairs.front());
+      this->pairs.pop_front();
+      this->refill.notify_one();
+      return dh_values;
+    }
+  }
+  return CryptoDriver().DH_initialize();
+}
+
+/**
+ * @brief Keeps the pool topped up. Pairs are generated outside the lock so
+ * Pop never waits on the worker.
+ */
+void DHKeyPool::Refill() {
+  CryptoDriver crypto_driver;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lck(this->mtx);
+      this->refill.wait(lck, [this] {
+        return this->stopping || this->pairs.size() < this->size;
+      });
+      if (this->stopping) {
+        return;
+      }
+    }
+    auto dh_values = crypto_driver.DH_initialize();
+
+    std::unique_lock<std::mutex> lck(this->mtx);
+    this->pairs.push_back(std::move(dh_values));
+    if (this->refill.wait_for(lck, this->refill_interval,
+                              [this] { return this->stopping; })) {
+      return;
+    }
+  }
+}
@@ -234,28 +234,34 @@ std::vector<VoteRow> DBDriver::all_votes() {
   std::vector<VoteRow> res;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
     VoteRow vote;
-    for (int colIndex = 0; colIndex < sqlite3_column_count(stmt); colIndex++) {
-      const void *raw_result = sqlite3_column_blob(stmt, colIndex);
-      int num_bytes = sqlite3_column_bytes(stmt, colIndex);
-      std::vector<unsigned char> data;
-      switch (colIndex) {
-      case 0:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        vote.votes.deserialize(data);
-        break;
-      case 1:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        vote.zkps.deserialize(data);
-        break;
-      case 2:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        vote.unblinded_signatures.deserialize(data);
-        break;
-      case 3:
-        vote.tallyer_signatures =
-            std::string((const char *)raw_result, num_bytes);
-        break;
+    // A row that does not decode is skipped rather than ending the read.
+    try {
+      for (int colIndex = 0; colIndex < sqlite3_column_count(stmt);
+           colIndex++) {
+        const void *raw_result = sqlite3_column_blob(stmt, colIndex);
+        int num_bytes = sqlite3_column_bytes(stmt, colIndex);
+        switch (colIndex) {
+        case 0:
+          vote.votes.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        case 1:
+          vote.zkps.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        case 2:
+          vote.unblinded_signatures.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        case 3:
+          vote.tallyer_signatures =
+              std::string((const char *)raw_result, num_bytes);
+          break;
+        }
       }
+    } catch (std::runtime_error &e) {
+      std::cerr << "Skipping unreadable vote: " << e.what() << std::endl;
+      continue;
     }
     res.push_back(vote);
   }
@@ -296,15 +302,14 @@ std::vector<VoteRow> DBDriver::all_votes() {
     for (int colIndex = 0; colIndex < sqlite3_column_count(stmt); colIndex++) {
       const void *raw_result = sqlite3_column_blob(stmt, colIndex);
       int num_bytes = sqlite3_column_bytes(stmt, colIndex);
-      std::vector<unsigned char> data;
       switch (colIndex) {
       case 0:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        vote.vote.deserialize(data);
+        vote.vote.deserialize(std::span<const unsigned char>(
+            (const unsigned char *)raw_result, num_bytes));
         break;
       case 1:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        vote.zkp.deserialize(data);
+        vote.zkp.deserialize(std::span<const unsigned char>(
+            (const unsigned char *)raw_result, num_bytes));
         break;
       case 2:
         vote.unblinded_signature =
@@ -477,28 +482,35 @@ DBDriver::DBDriver::all_partial_decryptions() {
   std::vector<PartialDecryptionRow> res;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
     PartialDecryptionRow partial_decryption;
-    for (int colIndex = 0; colIndex < sqlite3_column_count(stmt); colIndex++) {
-      const void *raw_result = sqlite3_column_blob(stmt, colIndex);
-      int num_bytes = sqlite3_column_bytes(stmt, colIndex);
-      std::vector<unsigned char> data;
-      switch (colIndex) {
-      case 0:
-        partial_decryption.arbiter_id =
-            std::string((const char *)raw_result, num_bytes);
-        break;
-      case 1:
-        partial_decryption.arbiter_vk_path =
-            std::string((const char *)raw_result, num_bytes);
-        break;
-      case 2:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.dec.deserialize(data);
-        break;
-      case 3:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.zkp.deserialize(data);
-        break;
+    // A row that does not decode is skipped rather than ending the read.
+    try {
+      for (int colIndex = 0; colIndex < sqlite3_column_count(stmt);
+           colIndex++) {
+        const void *raw_result = sqlite3_column_blob(stmt, colIndex);
+        int num_bytes = sqlite3_column_bytes(stmt, colIndex);
+        switch (colIndex) {
+        case 0:
+          partial_decryption.arbiter_id =
+              std::string((const char *)raw_result, num_bytes);
+          break;
+        case 1:
+          partial_decryption.arbiter_vk_path =
+              std::string((const char *)raw_result, num_bytes);
+          break;
+        case 2:
+          partial_decryption.dec.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        case 3:
+          partial_decryption.zkp.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        }
       }
+    } catch (std::runtime_error &e) {
+      std::cerr << "Skipping unreadable partial decryption: " << e.what()
+                << std::endl;
+      continue;
     }
     res.push_back(partial_decryption);
   }
@@ -535,28 +547,35 @@ DBDriver::DBDriver::row_partial_decryptions(int id) {
   std::vector<PartialDecryptionRow> res;
   while (sqlite3_step(stmt) == SQLITE_ROW) {
     PartialDecryptionRow partial_decryption;
-    for (int colIndex = 0; colIndex < sqlite3_column_count(stmt); colIndex++) {
-      const void *raw_result = sqlite3_column_blob(stmt, colIndex);
-      int num_bytes = sqlite3_column_bytes(stmt, colIndex);
-      std::vector<unsigned char> data;
-      switch (colIndex) {
-      case 0:
-        partial_decryption.arbiter_id =
-            std::string((const char *)raw_result, num_bytes);
-        break;
-      case 1:
-        partial_decryption.arbiter_vk_path =
-            std::string((const char *)raw_result, num_bytes);
-        break;
-      case 2:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.dec.deserialize(data);
-        break;
-      case 3:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.zkp.deserialize(data);
-        break;
+    // A row that does not decode is skipped rather than ending the read.
+    try {
+      for (int colIndex = 0; colIndex < sqlite3_column_count(stmt);
+           colIndex++) {
+        const void *raw_result = sqlite3_column_blob(stmt, colIndex);
+        int num_bytes = sqlite3_column_bytes(stmt, colIndex);
+        switch (colIndex) {
+        case 0:
+          partial_decryption.arbiter_id =
+              std::string((const char *)raw_result, num_bytes);
+          break;
+        case 1:
+          partial_decryption.arbiter_vk_path =
+              std::string((const char *)raw_result, num_bytes);
+          break;
+        case 2:
+          partial_decryption.dec.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        case 3:
+          partial_decryption.zkp.deserialize(std::span<const unsigned char>(
+              (const unsigned char *)raw_result, num_bytes));
+          break;
+        }
       }
+    } catch (std::runtime_error &e) {
+      std::cerr << "Skipping unreadable partial decryption: " << e.what()
+                << std::endl;
+      continue;
     }
     res.push_back(partial_decryption);
   }
@@ -593,7 +612,6 @@ PartialDecryptionRow DBDriver::find_partial_decryption(std::string arbiter_id) {
     for (int colIndex = 0; colIndex < sqlite3_column_count(stmt); colIndex++) {
       const void *raw_result = sqlite3_column_blob(stmt, colIndex);
       int num_bytes = sqlite3_column_bytes(stmt, colIndex);
-      std::vector<unsigned char> data;
       switch (colIndex) {
       case 0:
         partial_decryption.arbiter_id =
@@ -604,12 +622,12 @@ PartialDecryptionRow DBDriver::find_partial_decryption(std::string arbiter_id) {
             std::string((const char *)raw_result, num_bytes);
         break;
       case 2:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.dec.deserialize(data);
+        partial_decryption.dec.deserialize(std::span<const unsigned char>(
+            (const unsigned char *)raw_result, num_bytes));
         break;
       case 3:
-        data = str2chvec(std::string((const char *)raw_result, num_bytes));
-        partial_decryption.zkp.deserialize(data);
+        partial_decryption.zkp.deserialize(std::span<const unsigned char>(
+            (const unsigned char *)raw_result, num_bytes));
         break;
       }
     }
@@ -27,6 +27,7 @@ ArbiterClient::ArbiterClient(ArbiterConfig arbiter_config,
   this->db_driver->open(this->common_config.db_path);
   this->db_driver->init_tables();
   this->cli_driver->init();
+  ElectionClient::UseCompactProofs(common_config.compact_proofs);
 
   // Load arbiter keys.
   try {
@@ -58,6 +59,10 @@ ArbiterClient::ArbiterClient(ArbiterConfig arbiter_config,
     this->cli_driver->print_warning(
         "Error loading tallyer public key; application may be non-functional.");
   }
+  this->RSA_registrar_verifier =
+      std::make_shared<RSAVerifierHandle>(this->RSA_registrar_verification_key);
+  this->RSA_tallyer_verifier =
+      std::make_shared<RSAVerifierHandle>(this->RSA_tallyer_verification_key);
 }
 
 void ArbiterClient::run() {
@@ -108,45 +113,30 @@ void ArbiterClient::HandleAdjudicate(std::string _) {
     // std::cout<<"Gets"<<std::endl;
     std::vector<VoteRow> allV = this->db_driver->all_votes(); // std::vector<VoteRow> 
     std::vector<VoteRow> valid_vote;
+    std::vector<Serializable *> signed_votes;
+    std::vector<CryptoPP::Integer> unblinded_signatures;
+    // The candidate count most ballots agree on; CombineVotes skips the rest.
+    this->t = ElectionClient::CandidateCount(allV);
     for(auto &vMsg: allV) {
-        this->t = vMsg.votes.ct.size();
-        // std::cout<<"t-arbiter:"<<this->t<<std::endl;
-        bool invalid_voter = false;
-        for(int i = 0; i < this->t; i++) {
-            Vote_Ciphertext vote =  vMsg.votes.ct[i];
-            
-            // std::cout<<"inside vmsg"<<std::endl;
-            std::vector<unsigned char> en_data_vote;
-            vote.serialize(en_data_vote);
-            // std::cout<<chvec2str(en_data_vote)<<std::endl;
-
-            CryptoPP::Integer unblinded_signature =  vMsg.unblinded_signatures.ints[i];
-            VoteZKP_Struct zkp =  vMsg.zkps.zkp[i];
-            if(!crypto_driver->RSA_BLIND_verify(this->RSA_registrar_verification_key, vote, unblinded_signature)) {
-                throw std::runtime_error("Arbiter:blind verification fails!");
-                invalid_voter = true;
-                break;
-            }
-            if(!ElectionClient::VerifyVoteZKP(std::make_pair(vote, zkp), this->EG_arbiter_public_key)) {
-                throw std::runtime_error("Arbiter:ZKP verification fails!");
-                invalid_voter = true;
-                break;
-            }
+        for(size_t i = 0; i < vMsg.votes.ct.size(); i++) {
+            signed_votes.push_back(&vMsg.votes.ct[i]);
+            unblinded_signatures.push_back(vMsg.unblinded_signatures.ints[i]);
+        }
+    }
+    std::vector<bool> signature_valid = crypto_driver->RSA_BLIND_verify_batch(*this->RSA_registrar_verifier, signed_votes, unblinded_signatures);
+    if(std::find(signature_valid.begin(), signature_valid.end(), false) != signature_valid.end()) {
+        throw std::runtime_error("Arbiter:blind verification fails!");
+    }
+    //3) Verifies every vote and sum ZKP in one batch.
+    std::vector<bool> ballot_valid = ElectionClient::VerifyBallotBatch(allV, this->EG_arbiter_public_key, this->common_config.min_votes, this->common_config.max_votes);
+    for(size_t j = 0; j < allV.size(); j++) {
+        auto &vMsg = allV[j];
+        if(!ballot_valid[j]) {
+            throw std::runtime_error("Arbiter:ZKP verification fails!");
         }
-        if(invalid_voter) continue;
         //need to be consistent to tallyer - HandleTally
-        std::vector<unsigned char> vote_cipher_data;
-        vMsg.votes.serialize(vote_cipher_data);
-        std::vector<unsigned char> zkp_data;
-        
-
-        vMsg.zkps.serialize(zkp_data);
-        std::vector<unsigned char> signature_data;
-        vMsg.unblinded_signatures.serialize(signature_data);
-        
-        std::string sign_tallyer = chvec2str(vote_cipher_data) + chvec2str(zkp_data) + chvec2str(signature_data); 
-        
-        if(!crypto_driver->RSA_verify(this->RSA_tallyer_verification_key, str2chvec(sign_tallyer), vMsg.tallyer_signatures)) {
+        std::vector<unsigned char> sign_tallyer = concat_votes_zkps_and_signatures(vMsg.votes, vMsg.zkps, vMsg.unblinded_signatures);
+        if(!crypto_driver->RSA_verify(*this->RSA_tallyer_verifier, sign_tallyer, vMsg.tallyer_signatures)) {
             throw std::runtime_error("Arbiter:tallyer_signature verification fails!");
             continue;
         }
@@ -155,7 +145,7 @@ void ArbiterClient::HandleAdjudicate(std::string _) {
     //4) Combines all valid votes into one vote via `Election::CombineVotes`.
     // std::cout<<"Combines"<<std::endl;
 
-    std::vector<Vote_Ciphertext> combined_votes = ElectionClient::CombineVotes(valid_vote);
+    std::vector<Vote_Ciphertext> combined_votes = ElectionClient::CombineVotes(valid_vote, this->t);
 
     //5) Partially decrypts the combined vote.
     // std::cout<<"decrypts"<<std::endl;
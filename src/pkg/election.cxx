@@ -1,5 +1,21 @@
+#include <atomic>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include "../../include/pkg/election.hpp"
+#include "../../include-shared/discrete_log.hpp"
+#include "../../include-shared/group.hpp"
+#include "../../include-shared/keyloaders.hpp"
 #include "../../include-shared/logger.hpp"
+#include "../../include-shared/rng.hpp"
+#include "../../include-shared/transcript.hpp"
 
 /*
 Syntax to use logger:
@@ -8,64 +24,666 @@ See logger.hpp for more modes besides 'debug'
 */
 namespace {
 src::severity_logger<logging::trivial::severity_level> lg;
+
+/**
+ * -c mod q, so that x^c on one side of a verification equation becomes
+ * x^(q-c) on the other without an inversion. Only valid for x of order q.
+ */
+CryptoPP::Integer negate_scalar(const Group &group, const CryptoPP::Integer &c) {
+  const CryptoPP::Integer &q = group.Order();
+  return (q - c % q) % q;
 }
 
 /**
- * Generate Vote and ZKP.
+ * Fiat-Shamir challenge of a vote zkp, from the statement and commitments.
+ */
+CryptoPP::Integer vote_challenge(const Group &group, const CryptoPP::Integer &pk,
+                                 const Vote_Ciphertext &vote,
+                                 const VoteZKP_Struct &zkp) {
+  Transcript transcript("vote-zkp", group);
+  transcript.AbsorbElement("pk", pk);
+  transcript.AbsorbElement("a", vote.a);
+  transcript.AbsorbElement("b", vote.b);
+  transcript.AbsorbElement("a0", zkp.a0);
+  transcript.AbsorbElement("b0", zkp.b0);
+  transcript.AbsorbElement("a1", zkp.a1);
+  transcript.AbsorbElement("b1", zkp.b1);
+  return transcript.Challenge();
+}
+
+/**
+ * Fiat-Shamir challenge of a partial decryption zkp. Binds the claimed
+ * partial decryption d as well as the commitments.
+ */
+CryptoPP::Integer decryption_challenge(const Group &group,
+                                       const CryptoPP::Integer &pki,
+                                       const Vote_Ciphertext &vote,
+                                       const CryptoPP::Integer &d,
+                                       const CryptoPP::Integer &u,
+                                       const CryptoPP::Integer &v) {
+  Transcript transcript("decryption-zkp", group);
+  transcript.AbsorbElement("pk", pki);
+  transcript.AbsorbElement("a", vote.a);
+  transcript.AbsorbElement("b", vote.b);
+  transcript.AbsorbElement("d", d);
+  transcript.AbsorbElement("u", u);
+  transcript.AbsorbElement("v", v);
+  return transcript.Challenge();
+}
+
+/**
+ * Fiat-Shamir challenge of a ballot sum zkp.
+ */
+CryptoPP::Integer sum_challenge(const Group &group, const CryptoPP::Integer &pk,
+                                const Vote_Ciphertext &total, int min_votes,
+                                int max_votes, const SumZKP_Struct &sum) {
+  Transcript transcript("sum-zkp", group);
+  transcript.AbsorbElement("pk", pk);
+  transcript.AbsorbElement("a", total.a);
+  transcript.AbsorbElement("b", total.b);
+  transcript.AbsorbUint("min", min_votes);
+  transcript.AbsorbUint("max", max_votes);
+  for (size_t j = 0; j < sum.a.size(); j++) {
+    transcript.AbsorbElement("a_k", sum.a[j]);
+    transcript.AbsorbElement("b_k", sum.b[j]);
+  }
+  return transcript.Challenge();
+}
+
+// Exponentiations needed to expand one compact vote zkp.
+const size_t VOTE_ZKP_EXPS = 9;
+
+/**
+ * Recompute the commitments of compact vote zkps from their challenges and
+ * responses: a0 = g^r0 a^-c0, b0 = pk^r0 b^-c0, a1 = g^r1 a^-c1,
+ * b1 = pk^r1 g^c1 b^-c1. A proof is then valid iff its hash matches. The
+ * exponentiations of all the proofs go through one Group::BatchExp call.
+ */
+void expand_vote_zkps(
+    const Group &group, const CryptoPP::Integer &pk,
+    std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> &votes,
+    const std::vector<size_t> &indices) {
+  const CryptoPP::Integer &g = group.Generator();
+  std::vector<CryptoPP::Integer> bases;
+  std::vector<CryptoPP::Integer> exponents;
+  bases.reserve(indices.size() * VOTE_ZKP_EXPS);
+  exponents.reserve(indices.size() * VOTE_ZKP_EXPS);
+  for (size_t i : indices) {
+    const Vote_Ciphertext &vote = votes[i].first;
+    const VoteZKP_Struct &zkp = votes[i].second;
+    CryptoPP::Integer neg_c0 = negate_scalar(group, zkp.c0);
+    CryptoPP::Integer neg_c1 = negate_scalar(group, zkp.c1);
+    bases.insert(bases.end(),
+                 {g, vote.a, g, vote.a, pk, vote.b, pk, g, vote.b});
+    exponents.insert(exponents.end(), {zkp.r0, neg_c0, zkp.r1, neg_c1, zkp.r0,
+                                       neg_c0, zkp.r1, zkp.c1, neg_c1});
+  }
+  std::vector<CryptoPP::Integer> powers = group.BatchExp(bases, exponents);
+  for (size_t k = 0; k < indices.size(); k++) {
+    const CryptoPP::Integer *x = &powers[k * VOTE_ZKP_EXPS];
+    VoteZKP_Struct &zkp = votes[indices[k]].second;
+    zkp.a0 = group.Mul(x[0], x[1]);
+    zkp.a1 = group.Mul(x[2], x[3]);
+    zkp.b0 = group.Mul(x[4], x[5]);
+    zkp.b1 = group.Mul(group.Mul(x[6], x[7]), x[8]);
+  }
+}
+
+/**
+ * True if every element of the ballot and its proof is a group element.
+ */
+bool vote_elements_valid(const Group &group, const Vote_Ciphertext &vote,
+                         const VoteZKP_Struct &zkp) {
+  for (const CryptoPP::Integer *x :
+       {&vote.a, &vote.b, &zkp.a0, &zkp.b0, &zkp.a1, &zkp.b1}) {
+    if (!group.IsElement(*x)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * True if every challenge and response of the proof lies in [0, q).
+ */
+bool vote_scalars_valid(const Group &group, const VoteZKP_Struct &zkp) {
+  const CryptoPP::Integer &q = group.Order();
+  for (const CryptoPP::Integer *x : {&zkp.c0, &zkp.c1, &zkp.r0, &zkp.r1}) {
+    if (x->IsNegative() || *x >= q) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * True if the response of the proof lies in [0, q), and so does the
+ * challenge of a compact proof (full proofs recompute theirs).
+ */
+bool decryption_scalars_valid(const Group &group,
+                              const DecryptionZKP_Struct &zkp) {
+  const CryptoPP::Integer &q = group.Order();
+  if (zkp.s.IsNegative() || zkp.s >= q) {
+    return false;
+  }
+  return !zkp.compact || (!zkp.c.IsNegative() && zkp.c < q);
+}
+
+// Precomputed GenerateVote tuples for one election key, refilled by a
+// background thread up to `target`. The thread is stopped and joined when
+// the pool is destroyed at exit.
+struct VotePrecomputationPool {
+  std::mutex mtx;
+  std::condition_variable refill;
+  CryptoPP::Integer pk;
+  std::deque<VotePrecomputation> tuples;
+  size_t target = 0;
+  bool stopping = false;
+  std::thread worker;
+
+  ~VotePrecomputationPool() {
+    {
+      std::unique_lock<std::mutex> lck(this->mtx);
+      this->stopping = true;
+    }
+    this->refill.notify_all();
+    if (this->worker.joinable()) {
+      this->worker.join();
+    }
+  }
+};
+
+VotePrecomputationPool &vote_pool() {
+  static VotePrecomputationPool pool;
+  return pool;
+}
+
+// Integers per tuple when saved with SaveIntegers.
+const size_t VOTE_PRECOMPUTATION_INTS = 12;
+
+/**
+ * Take a tuple for pk from the pool, or compute one now if the pool is empty
+ * or holds tuples for another key.
+ */
+VotePrecomputation take_vote_precomputation(const CryptoPP::Integer &pk) {
+  VotePrecomputationPool &pool = vote_pool();
+  {
+    std::unique_lock<std::mutex> lck(pool.mtx);
+    if (pool.pk == pk && !pool.tuples.empty()) {
+      VotePrecomputation pre = std::move(pool.tuples.front());
+      pool.tuples.pop_front();
+      pool.refill.notify_one();
+      return pre;
+    }
+  }
+  return ElectionClient::PrecomputeVote(pk);
+}
+
+/**
+ * Keep the pool topped up to its target until it stops. Tuples are
+ * computed outside the lock so GenerateVote never waits on the worker.
+ */
+void vote_pool_worker() {
+  VotePrecomputationPool &pool = vote_pool();
+  while (true) {
+    CryptoPP::Integer pk;
+    {
+      std::unique_lock<std::mutex> lck(pool.mtx);
+      pool.refill.wait(lck, [&] {
+        return pool.stopping || pool.tuples.size() < pool.target;
+      });
+      if (pool.stopping) {
+        return;
+      }
+      pk = pool.pk;
+    }
+    VotePrecomputation pre = ElectionClient::PrecomputeVote(pk);
+    std::unique_lock<std::mutex> lck(pool.mtx);
+    if (pool.pk == pk) {
+      pool.tuples.push_back(std::move(pre));
+    }
+  }
+}
+
+// Whether GenerateVote and PartialDecrypt emit compact proofs.
+std::atomic<bool> compact_proofs(false);
+
+std::mutex dlog_mtx;
+std::string dlog_table_path;
+std::shared_ptr<const DiscreteLogTable> dlog_table;
+
+/**
+ * Baby-step table for the election group. Mapped from dlog_table_path if that file holds a
+ * valid table; otherwise built here and, if a path is set, saved for the
+ * next process.
+ */
+std::shared_ptr<const DiscreteLogTable> discrete_log_table() {
+  std::unique_lock<std::mutex> lck(dlog_mtx);
+  if (dlog_table) {
+    return dlog_table;
+  }
+  if (!dlog_table_path.empty() && std::filesystem::exists(dlog_table_path)) {
+    try {
+      dlog_table = DiscreteLogTable::Load(dlog_table_path, ElectionGroup());
+      return dlog_table;
+    } catch (std::exception &e) {
+      CUSTOM_LOG(lg, warning) << "Rebuilding discrete log table: " << e.what();
+    }
+  }
+  auto table =
+      std::make_shared<DiscreteLogTable>(ElectionGroup(), DLOG_BABY_STEPS);
+  if (!dlog_table_path.empty()) {
+    try {
+      table->Save(dlog_table_path);
+    } catch (std::exception &e) {
+      CUSTOM_LOG(lg, warning) << "Not saving discrete log table: " << e.what();
+    }
+  }
+  dlog_table = table;
+  return dlog_table;
+}
+
+// Smallest number of rows CombineVotes hands to one thread.
+const size_t COMBINE_MIN_CHUNK = 1024;
+
+// Running product of ciphertexts, kept in the group's internal form (e.g.
+// Montgomery form for MODP) until the value is read.
+struct CiphertextAccumulator {
+  std::unique_ptr<GroupAccumulator> a;
+  std::unique_ptr<GroupAccumulator> b;
+
+  explicit CiphertextAccumulator(const Group &group)
+      : a(group.NewAccumulator()), b(group.NewAccumulator()) {}
+  void Mul(const Vote_Ciphertext &ct) {
+    this->a->Mul(ct.a);
+    this->b->Mul(ct.b);
+  }
+  void Mul(const CiphertextAccumulator &other) {
+    this->a->Mul(*other.a);
+    this->b->Mul(*other.b);
+  }
+  Vote_Ciphertext Value() const {
+    Vote_Ciphertext ct;
+    ct.a = this->a->Value();
+    ct.b = this->b->Value();
+    return ct;
+  }
+};
+
+/**
+ * One identity accumulator per candidate.
+ */
+std::vector<CiphertextAccumulator> new_accumulators(const Group &group,
+                                                    size_t t) {
+  std::vector<CiphertextAccumulator> acc;
+  acc.reserve(t);
+  for (size_t i = 0; i < t; i++) {
+    acc.emplace_back(group);
+  }
+  return acc;
+}
+
+/**
+ * Multiply rows [begin, end) into acc. Each row is visited once and all of
+ * its candidates are folded in before moving on. Rows without exactly one
+ * ciphertext per accumulator are skipped; returns how many were.
+ */
+size_t combine_rows(const std::vector<VoteRow> &rows, size_t begin,
+                    size_t end, std::vector<CiphertextAccumulator> &acc) {
+  size_t skipped = 0;
+  for (size_t r = begin; r < end; r++) {
+    const std::vector<Vote_Ciphertext> &ct = rows[r].votes.ct;
+    if (ct.size() != acc.size()) {
+      skipped++;
+      continue;
+    }
+    for (size_t i = 0; i < acc.size(); i++) {
+      acc[i].Mul(ct[i]);
+    }
+  }
+  return skipped;
+}
+
+/**
+ * acc[i] *= other[i] for every candidate.
+ */
+void multiply_into(std::vector<CiphertextAccumulator> &acc,
+                   const std::vector<CiphertextAccumulator> &other) {
+  for (size_t i = 0; i < acc.size(); i++) {
+    acc[i].Mul(other[i]);
+  }
+}
+
+// Ballots per random linear combination; a failing chunk is bisected.
+const size_t VOTE_BATCH_SIZE = 128;
+
+/**
+ * Check the four CDS equations of every ballot in idx at once. Each equation
+ * is raised to an independent random BATCH_LAMBDA-bit exponent and all of
+ * them are multiplied together: the ciphertext and commitment side goes
+ * through one multi-exponentiation, the g and pk side through two single
+ * exponentiations. Every base has passed IsElement, so none has a
+ * small-order component the random exponents could cancel.
+ */
+bool vote_equations_hold(
+    const Group &group,
+    const std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> &votes,
+    const CryptoPP::Integer &pk, const size_t *idx, size_t n,
+    CryptoPP::RandomNumberGenerator &rng) {
+  std::vector<CryptoPP::Integer> bases;
+  std::vector<CryptoPP::Integer> exponents;
+  bases.reserve(6 * n);
+  exponents.reserve(6 * n);
+  CryptoPP::Integer g_exponent = 0;
+  CryptoPP::Integer pk_exponent = 0;
+
+  for (size_t k = 0; k < n; k++) {
+    const Vote_Ciphertext &vote = votes[idx[k]].first;
+    const VoteZKP_Struct &zkp = votes[idx[k]].second;
+    CryptoPP::Integer d[4];
+    for (CryptoPP::Integer &d_i : d) {
+      d_i.Randomize(rng, BATCH_LAMBDA);
+    }
+
+    // g^r0 = a0 a^c0, g^r1 = a1 a^c1, pk^r0 = b0 b^c0, pk^r1 g^c1 = b1 b^c1
+    bases.insert(bases.end(),
+                 {zkp.a0, zkp.a1, zkp.b0, zkp.b1, vote.a, vote.b});
+    exponents.insert(exponents.end(),
+                     {d[0], d[1], d[2], d[3], d[0] * zkp.c0 + d[1] * zkp.c1,
+                      d[2] * zkp.c0 + d[3] * zkp.c1});
+    g_exponent += d[0] * zkp.r0 + d[1] * zkp.r1 + d[3] * zkp.c1;
+    pk_exponent += d[2] * zkp.r0 + d[3] * zkp.r1;
+  }
+
+  // The right-hand side goes in with negated exponents, which is valid
+  // because g and pk have order q; no inversion needed.
+  CryptoPP::Integer lhs = group.MultiExp(bases, exponents);
+  CryptoPP::Integer quotient =
+      group.Mul(lhs, group.Mul(group.ExpGenerator(negate_scalar(group, g_exponent)),
+                               group.Exp(pk, negate_scalar(group, pk_exponent))));
+  return quotient == group.Identity();
+}
+
+/**
+ * Batch-check the ballots in idx, bisecting on failure until the invalid
+ * ones are isolated. Marks the ballots that pass in valid.
+ */
+void verify_vote_range(
+    const Group &group,
+    const std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> &votes,
+    const CryptoPP::Integer &pk, const size_t *idx, size_t n,
+    std::vector<bool> &valid, CryptoPP::RandomNumberGenerator &rng) {
+  if (n == 0) {
+    return;
+  }
+  if (vote_equations_hold(group, votes, pk, idx, n, rng)) {
+    for (size_t k = 0; k < n; k++) {
+      valid[idx[k]] = true;
+    }
+    return;
+  }
+  if (n == 1) {
+    return;
+  }
+  size_t half = n / 2;
+  verify_vote_range(group, votes, pk, idx, half, valid, rng);
+  verify_vote_range(group, votes, pk, idx + half, n - half, valid, rng);
+}
+
+/**
+ * Encrypt vote and prove it is 0 or 1 using the tuple pre.
  */
 std::pair<Vote_Ciphertext, VoteZKP_Struct>
-ElectionClient::GenerateVote(CryptoPP::Integer vote, CryptoPP::Integer pk) {
-  initLogger();
-  // TODO: implement me!
-    CryptoPP::AutoSeededRandomPool rng;
-    CryptoPP::Integer r;
-    do {
-        r.Randomize(rng, 2, DL_Q - 1); 
-    } while (CryptoPP::GCD(r, DL_Q) != 1); 
+vote_from_precomputation(const Group &group, const CryptoPP::Integer &vote,
+                         const CryptoPP::Integer &pk,
+                         const VotePrecomputation &pre) {
+    const CryptoPP::Integer &q = group.Order();
 
     Vote_Ciphertext vote_cipher;
-    vote_cipher.a = ModularExponentiation(DL_G, r, DL_P);
-    vote_cipher.b = a_times_b_mod_c(ModularExponentiation(pk, r, DL_P), ModularExponentiation(DL_G, vote, DL_P), DL_P);
+    vote_cipher.a = pre.g_r;
 
     VoteZKP_Struct zkp;
+    zkp.compact = compact_proofs;
     if(vote == 0) {
-        // zkp.c1.Randomize(rng, 0, n);//what is n??
-        zkp.c1.Randomize(rng, 1, DL_Q);//what is n??
-        zkp.r1.Randomize(rng, 1, DL_Q);
-        CryptoPP::Integer b_ = a_times_b_mod_c(vote_cipher.b, EuclideanMultiplicativeInverse(DL_G, DL_P), DL_P);
-        CryptoPP::Integer ac1 = ModularExponentiation(vote_cipher.a, zkp.c1, DL_P);
-        zkp.a1 = a_times_b_mod_c(ModularExponentiation(DL_G, zkp.r1, DL_P), EuclideanMultiplicativeInverse(ac1, DL_P), DL_P);
-        CryptoPP::Integer bc1 = ModularExponentiation(b_, zkp.c1, DL_P);
-        zkp.b1 = a_times_b_mod_c(ModularExponentiation(pk, zkp.r1, DL_P), EuclideanMultiplicativeInverse(bc1, DL_P), DL_P);
-        
-        CryptoPP::Integer r0_;
-        r0_.Randomize(rng, 1, DL_Q);
-        zkp.a0 = ModularExponentiation(DL_G, r0_, DL_P);
-        zkp.b0 = ModularExponentiation(pk, r0_, DL_P);
-
-        CryptoPP::Integer c = hash_vote_zkp(pk, vote_cipher.a, vote_cipher.b, zkp.a0, zkp.b0, zkp.a1, zkp.b1) % DL_Q;
-        zkp.c0 = ((c - zkp.c1) % DL_Q + DL_Q) % DL_Q;
-        zkp.r0 = (r0_ + zkp.c0 * r)% DL_Q;
+        vote_cipher.b = pre.pk_r;
+
+        // Simulated branch 1: a1 = g^r1 a^-c1, b1 = pk^r1 (b/g)^-c1 = pk^r1 g^c1 b^-c1
+        zkp.c1 = pre.c_sim;
+        zkp.r1 = pre.r_sim;
+        zkp.a1 = pre.g_sim;
+        zkp.b1 = group.Mul(pre.pk_sim, pre.g_c_sim);
+
+        zkp.a0 = pre.g_w;
+        zkp.b0 = pre.pk_w;
+
+        CryptoPP::Integer c = vote_challenge(group, pk, vote_cipher, zkp);
+        zkp.c0 = ((c - zkp.c1) % q + q) % q;
+        zkp.r0 = (pre.w + zkp.c0 * pre.r) % q;
     }else {
-        zkp.c0.Randomize(rng, 1, DL_Q);//
-        zkp.r0.Randomize(rng, 1, DL_Q);
-        CryptoPP::Integer ac0 = ModularExponentiation(vote_cipher.a, zkp.c0, DL_P);
-        CryptoPP::Integer bc0 = ModularExponentiation(vote_cipher.b, zkp.c0, DL_P);
-        zkp.a0 = a_times_b_mod_c(ModularExponentiation(DL_G, zkp.r0, DL_P), EuclideanMultiplicativeInverse(ac0, DL_P), DL_P);
-        zkp.b0 = a_times_b_mod_c(ModularExponentiation(pk, zkp.r0, DL_P), EuclideanMultiplicativeInverse(bc0, DL_P), DL_P);
-
-        CryptoPP::Integer r1_;
-        r1_.Randomize(rng, 1, DL_Q);
-        zkp.a1 = ModularExponentiation(DL_G, r1_, DL_P);
-        zkp.b1 = ModularExponentiation(pk, r1_, DL_P);
-
-        CryptoPP::Integer c = hash_vote_zkp(pk, vote_cipher.a, vote_cipher.b, zkp.a0, zkp.b0, zkp.a1, zkp.b1) % DL_Q;
-        zkp.c1 = ((c - zkp.c0) % DL_Q + DL_Q) % DL_Q;
-        zkp.r1 = (r1_ + zkp.c1 * r) % DL_Q;
+        vote_cipher.b = group.Mul(pre.pk_r, group.ExpGenerator(vote));
+
+        // Simulated branch 0: a0 = g^r0 a^-c0, b0 = pk^r0 b^-c0 = pk^r0 g^-c0 (pk^r)^-c0
+        zkp.c0 = pre.c_sim;
+        zkp.r0 = pre.r_sim;
+        zkp.a0 = pre.g_sim;
+        zkp.b0 = group.Mul(pre.pk_sim, pre.g_neg_c_sim);
+
+        zkp.a1 = pre.g_w;
+        zkp.b1 = pre.pk_w;
+
+        CryptoPP::Integer c = vote_challenge(group, pk, vote_cipher, zkp);
+        zkp.c1 = ((c - zkp.c0) % q + q) % q;
+        zkp.r1 = (pre.w + zkp.c1 * pre.r) % q;
     }
     return std::make_pair(vote_cipher, zkp);
 }
 
+/**
+ * Componentwise product of a ballot's ciphertexts, an encryption of the
+ * number of candidates selected.
+ */
+Vote_Ciphertext ballot_product(const Group &group,
+                               const Multi_Vote_Ciphertext &votes) {
+  CiphertextAccumulator total(group);
+  for (const Vote_Ciphertext &ct : votes.ct) {
+    total.Mul(ct);
+  }
+  return total.Value();
+}
+} // namespace
+
+/**
+ * Generate Vote and ZKP.
+ *
+ * All exponentiations happen in PrecomputeVote; with a tuple from the pool
+ * this is a couple of multiplications and the Fiat-Shamir hash.
+ */
+std::pair<Vote_Ciphertext, VoteZKP_Struct>
+ElectionClient::GenerateVote(CryptoPP::Integer vote, CryptoPP::Integer pk) {
+  initLogger();
+  VotePrecomputation pre = take_vote_precomputation(pk);
+  return vote_from_precomputation(*ElectionGroup(), vote, pk, pre);
+}
+
+/**
+ * Generate a ballot: one vote and 0/1 ZKP per candidate and, if max_votes is
+ * positive, a sum ZKP showing the ballot selects between min_votes and
+ * max_votes candidates. Throws if the votes break that limit.
+ */
+std::pair<Multi_Vote_Ciphertext, Multi_VoteZKP_Struct>
+ElectionClient::GenerateBallot(std::vector<CryptoPP::Integer> votes,
+                               CryptoPP::Integer pk, int min_votes,
+                               int max_votes) {
+  initLogger();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  const CryptoPP::Integer &q = group->Order();
+
+  Multi_Vote_Ciphertext ballot;
+  Multi_VoteZKP_Struct zkps;
+  CryptoPP::Integer r_total = CryptoPP::Integer::Zero();
+  long selected = 0;
+  for (const CryptoPP::Integer &vote : votes) {
+    VotePrecomputation pre = take_vote_precomputation(pk);
+    std::pair<Vote_Ciphertext, VoteZKP_Struct> vote_and_zkp =
+        vote_from_precomputation(*group, vote, pk, pre);
+    ballot.ct.push_back(vote_and_zkp.first);
+    zkps.zkp.push_back(vote_and_zkp.second);
+    r_total = (r_total + pre.r) % q;
+    selected += vote.ConvertToLong();
+  }
+  if (max_votes <= 0) {
+    return std::make_pair(ballot, zkps);
+  }
+  if (selected < min_votes || selected > max_votes) {
+    throw std::runtime_error("ballot must select between " +
+                             std::to_string(min_votes) + " and " +
+                             std::to_string(max_votes) + " candidates");
+  }
+
+  // (A, B) = (g^R, pk^R g^selected). Branch j claims B / g^(min_votes + j)
+  // = pk^R; every branch but the real one is simulated.
+  Vote_Ciphertext total = ballot_product(*group, ballot);
+  size_t branches = max_votes - min_votes + 1;
+  size_t real = selected - min_votes;
+  SumZKP_Struct sum;
+  sum.a.resize(branches);
+  sum.b.resize(branches);
+  sum.c.resize(branches);
+  sum.r.resize(branches);
+
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  CryptoPP::Integer g_inv = group->GeneratorInverse();
+  CryptoPP::Integer b_k = group->Mul(
+      total.b, group->ExpGenerator(negate_scalar(
+                   *group, CryptoPP::Integer(static_cast<long>(min_votes)))));
+  CryptoPP::Integer w;
+  CryptoPP::Integer c_simulated = CryptoPP::Integer::Zero();
+  for (size_t j = 0; j < branches; j++) {
+    if (j == real) {
+      w.Randomize(rng, 1, q - 1);
+      sum.a[j] = group->ExpGenerator(w);
+      sum.b[j] = group->Exp(pk, w);
+    } else {
+      sum.c[j].Randomize(rng, 0, q - 1);
+      sum.r[j].Randomize(rng, 0, q - 1);
+      CryptoPP::Integer neg_c = negate_scalar(*group, sum.c[j]);
+      sum.a[j] = group->Mul(group->ExpGenerator(sum.r[j]),
+                            group->Exp(total.a, neg_c));
+      sum.b[j] = group->Mul(group->Exp(pk, sum.r[j]), group->Exp(b_k, neg_c));
+      c_simulated += sum.c[j];
+    }
+    b_k = group->Mul(b_k, g_inv);
+  }
+  CryptoPP::Integer c =
+      sum_challenge(*group, pk, total, min_votes, max_votes, sum);
+  sum.c[real] = ((c - c_simulated) % q + q) % q;
+  sum.r[real] = (w + sum.c[real] * r_total) % q;
+  zkps.sum = sum;
+  return std::make_pair(ballot, zkps);
+}
+
+/**
+ * Compute one GenerateVote tuple for pk.
+ */
+VotePrecomputation ElectionClient::PrecomputeVote(CryptoPP::Integer pk) {
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  const CryptoPP::Integer &q = group->Order();
+  group->PrecomputeBase(pk);
+
+  VotePrecomputation pre;
+  pre.r.Randomize(rng, 2, q - 1);
+  pre.g_r = group->ExpGenerator(pre.r);
+  pre.pk_r = group->Exp(pk, pre.r);
+
+  pre.w.Randomize(rng, 1, q);
+  pre.g_w = group->ExpGenerator(pre.w);
+  pre.pk_w = group->Exp(pk, pre.w);
+
+  // With a = g^r and b = pk^r g^vote, the simulated commitments g^r_sim a^-c
+  // and pk^r_sim (pk^r)^-c collapse to single powers of g and pk.
+  pre.c_sim.Randomize(rng, 1, q);
+  pre.r_sim.Randomize(rng, 1, q);
+  CryptoPP::Integer e_sim = ((pre.r_sim - pre.r * pre.c_sim) % q + q) % q;
+  pre.g_sim = group->ExpGenerator(e_sim);
+  pre.pk_sim = group->Exp(pk, e_sim);
+  pre.g_c_sim = group->ExpGenerator(pre.c_sim);
+  pre.g_neg_c_sim = group->ExpGenerator(negate_scalar(*group, pre.c_sim));
+  return pre;
+}
+
+/**
+ * Keep up to pool_size tuples for pk ready on a background thread.
+ * Tuples for a previous key are dropped.
+ */
+void ElectionClient::StartVotePrecomputation(CryptoPP::Integer pk,
+                                             size_t pool_size) {
+  VotePrecomputationPool &pool = vote_pool();
+  std::unique_lock<std::mutex> lck(pool.mtx);
+  if (pool.pk != pk) {
+    pool.pk = pk;
+    pool.tuples.clear();
+  }
+  pool.target = pool_size;
+  if (!pool.worker.joinable() && pool_size > 0) {
+    pool.worker = std::thread(vote_pool_worker);
+  }
+  pool.refill.notify_one();
+}
+
+/**
+ * Compute count tuples for pk and write them to path, e.g. ahead of election
+ * day. The file holds the secret encryption randomness; keep it private.
+ */
+void ElectionClient::SaveVotePrecomputations(std::string path,
+                                             CryptoPP::Integer pk,
+                                             size_t count) {
+  Multi_Integer ints;
+  ints.ints.reserve(1 + count * VOTE_PRECOMPUTATION_INTS);
+  ints.ints.push_back(pk);
+  for (size_t i = 0; i < count; i++) {
+    VotePrecomputation pre = PrecomputeVote(pk);
+    ints.ints.insert(ints.ints.end(),
+                     {pre.r, pre.g_r, pre.pk_r, pre.w, pre.g_w, pre.pk_w,
+                      pre.c_sim, pre.r_sim, pre.g_sim, pre.pk_sim, pre.g_c_sim,
+                      pre.g_neg_c_sim});
+  }
+  SaveIntegers(path, ints);
+}
+
+/**
+ * Move the tuples saved at path into the pool and delete the file, so no
+ * tuple can be used twice. Returns the number of tuples loaded; a file for a
+ * different key is left alone and nothing is loaded.
+ */
+size_t ElectionClient::LoadVotePrecomputations(std::string path,
+                                               CryptoPP::Integer pk) {
+  initLogger();
+  Multi_Integer ints;
+  LoadIntegers(path, ints);
+  if (ints.ints.empty() || ints.ints[0] != pk ||
+      (ints.ints.size() - 1) % VOTE_PRECOMPUTATION_INTS != 0) {
+    CUSTOM_LOG(lg, warning) << "Ignoring precomputed votes in " << path;
+    return 0;
+  }
+  std::filesystem::remove(path);
+
+  VotePrecomputationPool &pool = vote_pool();
+  std::unique_lock<std::mutex> lck(pool.mtx);
+  if (pool.pk != pk) {
+    pool.pk = pk;
+    pool.tuples.clear();
+  }
+  size_t count = (ints.ints.size() - 1) / VOTE_PRECOMPUTATION_INTS;
+  for (size_t i = 0; i < count; i++) {
+    const CryptoPP::Integer *x = &ints.ints[1 + i * VOTE_PRECOMPUTATION_INTS];
+    pool.tuples.push_back(VotePrecomputation{x[0], x[1], x[2], x[3], x[4],
+                                             x[5], x[6], x[7], x[8], x[9],
+                                             x[10], x[11]});
+  }
+  return count;
+}
+
 /**
  * Verify vote zkp.
  */
@@ -77,18 +695,213 @@ bool ElectionClient::VerifyVoteZKP(
   // TODO: implement me!
     Vote_Ciphertext vote_cipher = vote.first;
     VoteZKP_Struct zkp = vote.second;
+    std::shared_ptr<const Group> group = ElectionGroup();
+    const CryptoPP::Integer &q = group->Order();
+    group->PrecomputeBase(pk);
 
-    if(ModularExponentiation(DL_G, zkp.r0, DL_P) != a_times_b_mod_c(zkp.a0, ModularExponentiation(vote_cipher.a, zkp.c0, DL_P), DL_P)) return false;
-    if(ModularExponentiation(DL_G, zkp.r1, DL_P) != a_times_b_mod_c(zkp.a1, ModularExponentiation(vote_cipher.a, zkp.c1, DL_P), DL_P)) return false;
+    if(!vote_scalars_valid(*group, zkp)) return false;
+    if(zkp.compact) {
+        if(!group->IsElement(vote_cipher.a) || !group->IsElement(vote_cipher.b)) return false;
+        std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> expanded{vote};
+        expand_vote_zkps(*group, pk, expanded, {0});
+        zkp = expanded[0].second;
+        return (zkp.c0 + zkp.c1) % q == vote_challenge(*group, pk, vote_cipher, zkp);
+    }
+    if(!group->IsElement(vote_cipher.a) || !group->IsElement(vote_cipher.b)) return false;
 
-    if(ModularExponentiation(pk, zkp.r0, DL_P) != a_times_b_mod_c(zkp.b0, ModularExponentiation(vote_cipher.b, zkp.c0, DL_P), DL_P)) return false;
+    // g^r0 a^-c0 = a0, g^r1 a^-c1 = a1, pk^r0 b^-c0 = b0, pk^r1 g^c1 b^-c1 = b1.
+    // Checked before the challenge: commitments that satisfy them are group
+    // elements, so they need no membership test of their own.
+    CryptoPP::Integer neg_c0 = negate_scalar(*group, zkp.c0);
+    CryptoPP::Integer neg_c1 = negate_scalar(*group, zkp.c1);
+    if(group->Mul(group->ExpGenerator(zkp.r0), group->Exp(vote_cipher.a, neg_c0)) != zkp.a0) return false;
+    if(group->Mul(group->ExpGenerator(zkp.r1), group->Exp(vote_cipher.a, neg_c1)) != zkp.a1) return false;
 
-    CryptoPP::Integer b_inv_g = a_times_b_mod_c(vote_cipher.b, EuclideanMultiplicativeInverse(DL_G, DL_P), DL_P);
-    if(ModularExponentiation(pk, zkp.r1, DL_P) != a_times_b_mod_c(zkp.b1, ModularExponentiation(b_inv_g, zkp.c1, DL_P), DL_P)) return false;
-    
-    if((zkp.c0 + zkp.c1) % DL_Q != hash_vote_zkp(pk, vote_cipher.a, vote_cipher.b, zkp.a0, zkp.b0, zkp.a1, zkp.b1) % DL_Q) return false;
+    if(group->Mul(group->Exp(pk, zkp.r0), group->Exp(vote_cipher.b, neg_c0)) != zkp.b0) return false;
+
+    CryptoPP::Integer pk_g = group->Mul(group->Exp(pk, zkp.r1), group->ExpGenerator(zkp.c1));
+    if(group->Mul(pk_g, group->Exp(vote_cipher.b, neg_c1)) != zkp.b1) return false;
 
+    return (zkp.c0 + zkp.c1) % q == vote_challenge(*group, pk, vote_cipher, zkp);
+}
+
+/**
+ * Verify many vote zkps at once. Returns one flag per input pair.
+ *
+ * The Fiat-Shamir challenge is still checked per ballot (it is only a hash);
+ * the group equations are checked VOTE_BATCH_SIZE ballots at a time with a
+ * random linear combination, and a failing chunk is bisected to find the bad
+ * ballots. Every element is checked for subgroup membership first, so this
+ * accepts exactly the ballots VerifyVoteZKP accepts, except with probability
+ * 2^-BATCH_LAMBDA per failing chunk.
+ */
+std::vector<bool> ElectionClient::VerifyVoteZKPBatch(
+    std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes,
+    CryptoPP::Integer pk) {
+  initLogger();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  const CryptoPP::Integer &q = group->Order();
+  group->PrecomputeBase(pk);
+  std::vector<bool> valid(votes.size(), false);
+
+  std::vector<size_t> pending;
+  std::vector<size_t> compact;
+  pending.reserve(votes.size());
+  for (size_t i = 0; i < votes.size(); i++) {
+    const Vote_Ciphertext &vote = votes[i].first;
+    const VoteZKP_Struct &zkp = votes[i].second;
+    // Compact proofs have no commitments to combine; recomputing them is
+    // already a full verification, done for all of them together below.
+    if (!vote_scalars_valid(*group, zkp)) {
+      continue;
+    }
+    if (zkp.compact) {
+      if (group->IsElement(vote.a) && group->IsElement(vote.b)) {
+        compact.push_back(i);
+      }
+      continue;
+    }
+    if (!vote_elements_valid(*group, vote, zkp)) {
+      continue;
+    }
+    if ((zkp.c0 + zkp.c1) % q != vote_challenge(*group, pk, vote, zkp)) {
+      continue;
+    }
+    pending.push_back(i);
+  }
+
+  expand_vote_zkps(*group, pk, votes, compact);
+  for (size_t i : compact) {
+    const VoteZKP_Struct &zkp = votes[i].second;
+    valid[i] = (zkp.c0 + zkp.c1) % q ==
+               vote_challenge(*group, pk, votes[i].first, zkp);
+  }
+
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  for (size_t start = 0; start < pending.size(); start += VOTE_BATCH_SIZE) {
+    size_t n = std::min(VOTE_BATCH_SIZE, pending.size() - start);
+    verify_vote_range(*group, votes, pk, pending.data() + start, n, valid,
+                      rng);
+  }
+  return valid;
+}
+
+/**
+ * Verify the sum ZKP of a ballot against the election's limit on the number
+ * of candidates selected. Always true when max_votes is 0; otherwise the
+ * proof must be present and have one branch per allowed count. The ballot's
+ * ciphertexts must already have passed VerifyVoteZKP or VerifyVoteZKPBatch,
+ * which check that they are group elements.
+ */
+bool ElectionClient::VerifyBallotSum(const Multi_Vote_Ciphertext &votes,
+                                     const Multi_VoteZKP_Struct &zkps,
+                                     CryptoPP::Integer pk, int min_votes,
+                                     int max_votes) {
+  if (max_votes <= 0) {
     return true;
+  }
+  if (!zkps.sum || min_votes > max_votes) {
+    return false;
+  }
+  const SumZKP_Struct &sum = *zkps.sum;
+  size_t branches = max_votes - min_votes + 1;
+  if (sum.a.size() != branches || sum.b.size() != branches ||
+      sum.c.size() != branches || sum.r.size() != branches) {
+    return false;
+  }
+
+  std::shared_ptr<const Group> group = ElectionGroup();
+  const CryptoPP::Integer &q = group->Order();
+  CryptoPP::Integer c_total = CryptoPP::Integer::Zero();
+  for (size_t j = 0; j < branches; j++) {
+    if (sum.c[j].IsNegative() || sum.c[j] >= q || sum.r[j].IsNegative() ||
+        sum.r[j] >= q) {
+      return false;
+    }
+    c_total += sum.c[j];
+  }
+
+  // g^r A^-c = a and pk^r (B / g^k)^-c = b for every branch. Checked before
+  // the challenge: commitments that satisfy them are group elements.
+  Vote_Ciphertext total = ballot_product(*group, votes);
+  group->PrecomputeBase(pk);
+  CryptoPP::Integer g_inv = group->GeneratorInverse();
+  CryptoPP::Integer b_k = group->Mul(
+      total.b, group->ExpGenerator(negate_scalar(
+                   *group, CryptoPP::Integer(static_cast<long>(min_votes)))));
+  for (size_t j = 0; j < branches; j++) {
+    CryptoPP::Integer neg_c = negate_scalar(*group, sum.c[j]);
+    if (group->Mul(group->ExpGenerator(sum.r[j]),
+                   group->Exp(total.a, neg_c)) != sum.a[j] ||
+        group->Mul(group->Exp(pk, sum.r[j]), group->Exp(b_k, neg_c)) !=
+            sum.b[j]) {
+      return false;
+    }
+    b_k = group->Mul(b_k, g_inv);
+  }
+  return c_total % q ==
+         sum_challenge(*group, pk, total, min_votes, max_votes, sum);
+}
+
+/**
+ * Verify whole ballots: every candidate's 0/1 ZKP, all ballots in one batch,
+ * and each ballot's sum ZKP. Returns one flag per ballot.
+ */
+std::vector<bool>
+ElectionClient::VerifyBallotBatch(const std::vector<VoteRow> &ballots,
+                                  CryptoPP::Integer pk, int min_votes,
+                                  int max_votes) {
+  std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> all_zkps;
+  std::vector<bool> valid(ballots.size(), true);
+  for (size_t j = 0; j < ballots.size(); j++) {
+    const VoteRow &ballot = ballots[j];
+    if (ballot.votes.ct.size() != ballot.zkps.zkp.size()) {
+      valid[j] = false;
+      continue;
+    }
+    for (size_t i = 0; i < ballot.votes.ct.size(); i++) {
+      all_zkps.push_back(
+          std::make_pair(ballot.votes.ct[i], ballot.zkps.zkp[i]));
+    }
+  }
+  std::vector<bool> zkp_valid = VerifyVoteZKPBatch(all_zkps, pk);
+
+  size_t zkp_index = 0;
+  for (size_t j = 0; j < ballots.size(); j++) {
+    if (!valid[j]) {
+      continue;
+    }
+    for (size_t i = 0; i < ballots[j].votes.ct.size(); i++, zkp_index++) {
+      if (!zkp_valid[zkp_index]) {
+        valid[j] = false;
+      }
+    }
+    if (valid[j] && !VerifyBallotSum(ballots[j].votes, ballots[j].zkps, pk,
+                                     min_votes, max_votes)) {
+      valid[j] = false;
+    }
+  }
+  return valid;
+}
+
+/**
+ * Choose whether GenerateVote and PartialDecrypt emit compact proofs (only
+ * challenges and responses). Verification accepts either form.
+ */
+void ElectionClient::UseCompactProofs(bool compact) {
+  compact_proofs = compact;
+}
+
+/**
+ * Set the file backing the discrete log table used by CombineResults. The
+ * table is mapped (or built and saved) on first use.
+ */
+void ElectionClient::UseDiscreteLogTable(std::string path) {
+  std::unique_lock<std::mutex> lck(dlog_mtx);
+  if (path != dlog_table_path) {
+    dlog_table_path = path;
+    dlog_table.reset();
+  }
 }
 
 /**
@@ -103,17 +916,20 @@ ElectionClient::PartialDecrypt(Vote_Ciphertext combined_vote,
 struct PartialDecryption_Struct : public Serializable {
   CryptoPP::Integer d;
   Vote_Ciphertext aggregate_ciphertext;*/
-    CryptoPP::AutoSeededRandomPool rng;
+    CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+    std::shared_ptr<const Group> group = ElectionGroup();
+    const CryptoPP::Integer &q = group->Order();
     CryptoPP::Integer r;
-    r.Randomize(rng, 1, DL_Q); 
-    CryptoPP::Integer u = ModularExponentiation(combined_vote.a, r, DL_P);
-    CryptoPP::Integer v = ModularExponentiation(DL_G, r, DL_P);
-    CryptoPP::Integer c = hash_dec_zkp(pk, combined_vote.a, combined_vote.b, u, v);
-    CryptoPP::Integer s = (r + a_times_b_mod_c(c, sk, DL_Q)) % DL_Q;
-    CryptoPP::Integer d = ModularExponentiation(combined_vote.a, sk, DL_P);
-
-    if(ModularExponentiation(combined_vote.a, s, DL_P) != a_times_b_mod_c(u, ModularExponentiation(d, c, DL_P), DL_P)
-        || ModularExponentiation(DL_G, s, DL_P) != a_times_b_mod_c(v, ModularExponentiation(pk, c, DL_P), DL_P)){
+    r.Randomize(rng, 1, q); 
+    CryptoPP::Integer u = group->Exp(combined_vote.a, r);
+    CryptoPP::Integer v = group->ExpGenerator(r);
+    CryptoPP::Integer d = group->Exp(combined_vote.a, sk);
+    CryptoPP::Integer c = decryption_challenge(*group, pk, combined_vote, d, u, v);
+    CryptoPP::Integer s = (r + a_times_b_mod_c(c, sk, q)) % q;
+
+    CryptoPP::Integer neg_c = negate_scalar(*group, c);
+    if(group->MultiExp({combined_vote.a, d}, {s, neg_c}) != u
+        || group->Mul(group->ExpGenerator(s), group->Exp(pk, neg_c)) != v){
             std::cerr<<"PartialDecrypt verification error"<<std::endl;
         }
 
@@ -125,6 +941,8 @@ struct PartialDecryption_Struct : public Serializable {
     de_zkp.u = u;
     de_zkp.v = v;
     de_zkp.s = s;
+    de_zkp.c = c;
+    de_zkp.compact = compact_proofs;
 
     return std::make_pair(partial_de, de_zkp);
 }
@@ -138,35 +956,100 @@ bool ElectionClient::VerifyPartialDecryptZKP(
   initLogger();
   // TODO: implement me!
     Vote_Ciphertext combined_vote = a2w_dec_s.dec.aggregate_ciphertext;
-    CryptoPP::Integer c = hash_dec_zkp(pki, combined_vote.a, combined_vote.b, a2w_dec_s.zkp.u, a2w_dec_s.zkp.v);
-    if(ModularExponentiation(combined_vote.a, a2w_dec_s.zkp.s, DL_P) != a_times_b_mod_c(a2w_dec_s.zkp.u, ModularExponentiation(a2w_dec_s.dec.d, c, DL_P), DL_P)
-        || ModularExponentiation(DL_G, a2w_dec_s.zkp.s, DL_P) != a_times_b_mod_c(a2w_dec_s.zkp.v, ModularExponentiation(pki, c, DL_P), DL_P)){
+    std::shared_ptr<const Group> group = ElectionGroup();
+    if(!decryption_scalars_valid(*group, a2w_dec_s.zkp)) return false;
+    if(a2w_dec_s.zkp.compact) {
+        // Recompute u = a^s d^-c and v = g^s pki^-c, then check the hash.
+        for(const CryptoPP::Integer *x : {&combined_vote.a, &combined_vote.b, &a2w_dec_s.dec.d, &pki}) {
+            if(!group->IsElement(*x)) return false;
+        }
+        CryptoPP::Integer neg_c = negate_scalar(*group, a2w_dec_s.zkp.c);
+        CryptoPP::Integer u = group->MultiExp({combined_vote.a, a2w_dec_s.dec.d}, {a2w_dec_s.zkp.s, neg_c});
+        CryptoPP::Integer v = group->Mul(group->ExpGenerator(a2w_dec_s.zkp.s), group->Exp(pki, neg_c));
+        return a2w_dec_s.zkp.c == decryption_challenge(*group, pki, combined_vote, a2w_dec_s.dec.d, u, v);
+    }
+    for(const CryptoPP::Integer *x : {&combined_vote.a, &combined_vote.b, &a2w_dec_s.dec.d, &a2w_dec_s.zkp.u, &a2w_dec_s.zkp.v, &pki}) {
+        if(!group->IsElement(*x)) return false;
+    }
+    CryptoPP::Integer c = decryption_challenge(*group, pki, combined_vote, a2w_dec_s.dec.d, a2w_dec_s.zkp.u, a2w_dec_s.zkp.v);
+    // a^s d^-c = u and g^s pki^-c = v; the two variable bases of the first
+    // equation share one chain of squarings.
+    CryptoPP::Integer neg_c = negate_scalar(*group, c);
+    if(group->MultiExp({combined_vote.a, a2w_dec_s.dec.d}, {a2w_dec_s.zkp.s, neg_c}) != a2w_dec_s.zkp.u
+        || group->Mul(group->ExpGenerator(a2w_dec_s.zkp.s), group->Exp(pki, neg_c)) != a2w_dec_s.zkp.v){
             return false;
         }
     return true;
 }
 
 /**
- * Combine votes into one using homomorphic encryption.
+ * The number of candidates most rows vote on, for callers that have no
+ * configured count; 0 if there are no rows.
+ */
+size_t ElectionClient::CandidateCount(const std::vector<VoteRow> &all_votes) {
+  std::map<size_t, size_t> sizes;
+  for (const VoteRow &row : all_votes) {
+    sizes[row.votes.ct.size()]++;
+  }
+  size_t candidates = 0;
+  size_t rows = 0;
+  for (const auto &[size, count] : sizes) {
+    if (count > rows) {
+      candidates = size;
+      rows = count;
+    }
+  }
+  return candidates;
+}
+
+/**
+ * Combine votes into one using homomorphic encryption. Rows without exactly
+ * one ciphertext per candidate are skipped; with no rows, every candidate's
+ * combined vote is the identity.
  */
-std::vector<Vote_Ciphertext> ElectionClient::CombineVotes(std::vector<VoteRow> all_votes) {
+std::vector<Vote_Ciphertext>
+ElectionClient::CombineVotes(const std::vector<VoteRow> &all_votes,
+                             size_t candidates) {
   initLogger();
-  // TODO: implement me!
-    int t = all_votes[0].votes.ct.size(); // t candidates
-    std::vector<Vote_Ciphertext> combined_votes;
-    for(int i = 0; i < t; i++) {
-        Vote_Ciphertext combine_vote;
-        combine_vote.a = 1;
-        combine_vote.b = 1;
-        for(auto &vote_msg: all_votes) {
-            combine_vote.a = a_times_b_mod_c(combine_vote.a, vote_msg.votes.ct[i].a, DL_P);
-            combine_vote.b = a_times_b_mod_c(combine_vote.b, vote_msg.votes.ct[i].b, DL_P);
-        }
+  std::shared_ptr<const Group> group = ElectionGroup();
+  size_t t = candidates;
 
-        combined_votes.push_back(combine_vote);
-    }
-    
-    return combined_votes;
+  // One chunk per core, but no chunk smaller than COMBINE_MIN_CHUNK rows.
+  // Chunk 0 runs on this thread.
+  size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t chunks = std::clamp<size_t>(
+      (all_votes.size() + COMBINE_MIN_CHUNK - 1) / COMBINE_MIN_CHUNK, 1,
+      threads);
+  size_t chunk_size = (all_votes.size() + chunks - 1) / chunks;
+
+  std::vector<std::vector<CiphertextAccumulator>> partials;
+  for (size_t c = 0; c < chunks; c++) {
+    partials.push_back(new_accumulators(*group, t));
+  }
+  auto combine_chunk = [&](size_t c) {
+    size_t begin = c * chunk_size;
+    size_t end = std::min(all_votes.size(), begin + chunk_size);
+    return combine_rows(all_votes, begin, end, partials[c]);
+  };
+  std::vector<std::future<size_t>> workers;
+  for (size_t c = 1; c < chunks; c++) {
+    workers.push_back(std::async(std::launch::async, combine_chunk, c));
+  }
+  size_t skipped = combine_chunk(0);
+  for (size_t c = 1; c < chunks; c++) {
+    skipped += workers[c - 1].get();
+    multiply_into(partials[0], partials[c]);
+  }
+  if (skipped > 0) {
+    CUSTOM_LOG(lg, warning) << "CombineVotes skipped " << skipped
+                            << " rows without " << t << " ciphertexts";
+  }
+
+  std::vector<Vote_Ciphertext> combined;
+  for (const CiphertextAccumulator &acc : partials[0]) {
+    combined.push_back(acc.Value());
+  }
+  return combined;
 }
 
 /**
@@ -176,20 +1059,48 @@ CryptoPP::Integer ElectionClient::CombineResults(
     Vote_Ciphertext combined_vote,
     std::vector<PartialDecryptionRow> all_partial_decryptions) {
   initLogger();
-  // TODO: implement me!
-  /*  std::string arbiter_id;
-  std::string arbiter_vk_path;
-  PartialDecryption_Struct dec;
-  DecryptionZKP_Struct zkp;*/
-    CryptoPP::Integer d_mul = 1;
-    for(auto &part_dec: all_partial_decryptions) {
-        d_mul = a_times_b_mod_c(d_mul, part_dec.dec.d, DL_P); //mod p or not?
-    }
-    CryptoPP::Integer g_m = a_times_b_mod_c(combined_vote.b, EuclideanMultiplicativeInverse(d_mul, DL_P), DL_P);
-    for(CryptoPP::Integer i = 0; i < 3000; i++) {
-        if(ModularExponentiation(DL_G, i, DL_P) == g_m) return i;
-    }
-    std::cerr<<"cant find matching m!"<<std::endl;
-    return -1;
+  return CombineResultsBatch({combined_vote}, {all_partial_decryptions})[0];
+}
+
+/**
+ * Combine the partial decryptions of every candidate's combined vote. The
+ * products of the partial decryptions are inverted together, with a single
+ * modular inversion. Entries that cannot be solved are -1.
+ */
+std::vector<CryptoPP::Integer> ElectionClient::CombineResultsBatch(
+    std::vector<Vote_Ciphertext> combined_votes,
+    std::vector<std::vector<PartialDecryptionRow>> all_partial_decryptions) {
+  initLogger();
+    std::shared_ptr<const Group> group = ElectionGroup();
+    std::vector<CryptoPP::Integer> d_products;
+    for(auto &partial_decryptions: all_partial_decryptions) {
+        std::unique_ptr<GroupAccumulator> d_acc = group->NewAccumulator();
+        for(auto &part_dec: partial_decryptions) {
+            d_acc->Mul(part_dec.dec.d);
+        }
+        d_products.push_back(d_acc->Value());
+    }
+    std::vector<CryptoPP::Integer> d_inverses;
+    try {
+        d_inverses = group->BatchInverse(d_products);
+    } catch (std::invalid_argument &) {
+        // Fall back so one bad candidate does not sink the others.
+        for(auto &d_product: d_products) {
+            d_inverses.push_back(group->Inverse(d_product));
+        }
+    }
+
+    std::vector<CryptoPP::Integer> results;
+    for(size_t i = 0; i < combined_votes.size(); i++) {
+        CryptoPP::Integer g_m = group->Mul(combined_votes[i].b, d_inverses[i]);
+        CryptoPP::Integer m;
+        if(discrete_log_table()->Solve(g_m, DLOG_MAX_TALLY, m)) {
+            results.push_back(m);
+        } else {
+            std::cerr<<"cant find matching m!"<<std::endl;
+            results.push_back(-1);
+        }
+    }
+    return results;
 }
 
@@ -1,4 +1,5 @@
 #include "../../include/pkg/registrar.hpp"
+#include "../../include-shared/constants.hpp"
 #include "../../include-shared/keyloaders.hpp"
 #include "../../include-shared/logger.hpp"
 
@@ -44,6 +45,11 @@ RegistrarClient::RegistrarClient(RegistrarConfig registrar_config,
     SaveRSAPublicKey(common_config.registrar_verification_key_path,
                      this->RSA_registrar_verification_key);
   }
+  this->RSA_registrar_signer =
+      std::make_shared<RSASignerHandle>(this->RSA_registrar_signing_key);
+  this->session_ticket_key = CryptoDriver().SESSION_generate_ticket_key();
+  this->dh_pool = std::make_shared<DHKeyPool>(
+      registrar_config.dh_pool_size, registrar_config.dh_pool_refill_ms);
 
   // Load election public key
   try {
@@ -99,42 +105,69 @@ void RegistrarClient::ListenForConnections(int port) {
 }
 
 /**
- * Handle key exchange with voter
+ * Handle key exchange with voter. Throws std::runtime_error if the voter
+ * sends a malformed message.
  */
 std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock>
 RegistrarClient::HandleKeyExchange(
     std::shared_ptr<NetworkDriver> network_driver,
     std::shared_ptr<CryptoDriver> crypto_driver) {
-  // Generate private/public DH keys
-  auto dh_values = crypto_driver->DH_initialize();
-
-  // Listen for g^a
+  // Listen for g^a, or for a ticket to resume an earlier session. If the
+  // ticket is declined, the user continues with g^a.
   std::vector<unsigned char> user_public_value = network_driver->read();
+  if (get_message_type(user_public_value) ==
+      MessageType::UserToServer_Resume_Message) {
+    UserToServer_Resume_Message resume_s;
+    resume_s.deserialize(user_public_value);
+    auto [reply_s, keys] = crypto_driver->SESSION_resume(
+        this->session_ticket_key, resume_s, this->common_config.aead_channel);
+    std::vector<unsigned char> reply_bytes;
+    reply_s.serialize(reply_bytes);
+    network_driver->send(reply_bytes);
+    if (reply_s.accepted) {
+      return keys;
+    }
+    user_public_value = network_driver->read();
+  }
   UserToServer_DHPublicValue_Message user_public_value_s;
   user_public_value_s.deserialize(user_public_value);
 
-  // Respond with m = (g^b, g^a) signed with our private RSA key
+  // Take private/public DH keys from the pool
+  auto dh_values = this->dh_pool->Pop();
+
+  // Recover g^ab
+  CryptoPP::SecByteBlock DH_shared_key = crypto_driver->DH_generate_shared_key(
+      std::get<0>(dh_values), std::get<1>(dh_values),
+      user_public_value_s.public_value);
+
+  // Respond with m = (g^b, g^a, mode) signed with our private RSA key
   ServerToUser_DHPublicValue_Message public_value_s;
   public_value_s.server_public_value = std::get<2>(dh_values);
   public_value_s.user_public_value = user_public_value_s.public_value;
+  public_value_s.channel_mode =
+      user_public_value_s.channel_mode == ChannelMode::AES_GCM &&
+              this->common_config.aead_channel
+          ? ChannelMode::AES_GCM
+          : ChannelMode::CBC_HMAC;
   public_value_s.server_signature = crypto_driver->RSA_sign(
-      this->RSA_registrar_signing_key,
-      concat_byteblocks(public_value_s.server_public_value,
-                        public_value_s.user_public_value));
+      *this->RSA_registrar_signer, concat_dh_values_and_mode(public_value_s));
+  if (this->common_config.session_ticket_lifetime > 0) {
+    public_value_s.session_ticket = crypto_driver->SESSION_seal_ticket(
+        this->session_ticket_key,
+        crypto_driver->SESSION_generate_secret(DH_shared_key),
+        this->common_config.session_ticket_lifetime);
+  }
 
   // Sign and send message
   std::vector<unsigned char> message_bytes;
   public_value_s.serialize(message_bytes);
   network_driver->send(message_bytes);
 
-  // Recover g^ab
-  CryptoPP::SecByteBlock DH_shared_key = crypto_driver->DH_generate_shared_key(
-      std::get<0>(dh_values), std::get<1>(dh_values),
-      user_public_value_s.public_value);
   CryptoPP::SecByteBlock AES_key =
       crypto_driver->AES_generate_key(DH_shared_key);
   CryptoPP::SecByteBlock HMAC_key =
       crypto_driver->HMAC_generate_key(DH_shared_key);
+  crypto_driver->set_channel_mode(public_value_s.channel_mode);
   return std::make_pair(AES_key, HMAC_key);
 }
 
@@ -152,7 +185,15 @@ void RegistrarClient::HandleRegister(
     std::shared_ptr<CryptoDriver> crypto_driver) {
   // TODO: implement me!
     //1) Handles key exchange.
-    auto keys = HandleKeyExchange(network_driver, crypto_driver);
+    // A malformed key exchange message ends only this connection.
+    std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock> keys;
+    try {
+        keys = HandleKeyExchange(network_driver, crypto_driver);
+    } catch (std::runtime_error &e) {
+        this->cli_driver->print_warning(e.what());
+        network_driver->disconnect();
+        return;
+    }
     CryptoPP::SecByteBlock AES_key = keys.first;
     CryptoPP::SecByteBlock HMAC_key = keys.second;
 
@@ -166,7 +207,13 @@ void RegistrarClient::HandleRegister(
         return;
     }
     VoterToRegistrar_Register_Messages v2r_rgs_m;
-    v2r_rgs_m.deserialize(v2r_data.first);
+    try {
+        v2r_rgs_m.deserialize(v2r_data.first);
+    } catch (std::runtime_error &e) {
+        this->cli_driver->print_warning(e.what());
+        network_driver->disconnect();
+        return;
+    }
     //id, vote
     //if needed: VoterToRegistrar_Register_Message 可以加一个参数，
     this->t = v2r_rgs_m.votes.ints.size();
@@ -180,7 +227,14 @@ void RegistrarClient::HandleRegister(
             all_registrar_signatures.ints.push_back(current_voter_info.registrar_signature);
             // std::cout << "/n Detect this Voter has registered before!/n" << std::endl;
         }else {
-            CryptoPP::Integer each_registrar_signature = crypto_driver->RSA_BLIND_sign(RSA_registrar_signing_key, v2r_rgs_m.votes.ints[i]);
+            CryptoPP::Integer each_registrar_signature;
+            try {
+                each_registrar_signature = crypto_driver->RSA_BLIND_sign(*RSA_registrar_signer, v2r_rgs_m.votes.ints[i]);
+            } catch (std::runtime_error &e) {
+                this->cli_driver->print_warning(e.what());
+                network_driver->disconnect();
+                return;
+            }
             current_voter_info.id = voter_id;
             // current_voter_info.candidate_id = std::to_string(i);
             current_voter_info.registrar_signature = each_registrar_signature;
@@ -46,6 +46,11 @@ TallyerClient::TallyerClient(TallyerConfig tallyer_config,
     SaveRSAPublicKey(common_config.tallyer_verification_key_path,
                      this->RSA_tallyer_verification_key);
   }
+  this->RSA_tallyer_signer =
+      std::make_shared<RSASignerHandle>(this->RSA_tallyer_signing_key);
+  this->session_ticket_key = CryptoDriver().SESSION_generate_ticket_key();
+  this->dh_pool = std::make_shared<DHKeyPool>(
+      tallyer_config.dh_pool_size, tallyer_config.dh_pool_refill_ms);
 
   // Load election public key
   try {
@@ -64,6 +69,8 @@ TallyerClient::TallyerClient(TallyerConfig tallyer_config,
     this->cli_driver->print_warning("Error loading registrar public key; "
                                     "application may be non-functional.");
   }
+  this->RSA_registrar_verifier =
+      std::make_shared<RSAVerifierHandle>(this->RSA_registrar_verification_key);
 }
 
 /**
@@ -103,41 +110,68 @@ void TallyerClient::ListenForConnections(int port) {
 }
 
 /**
- * Handle key exchange with voter
+ * Handle key exchange with voter. Throws std::runtime_error if the voter
+ * sends a malformed message.
  */
 std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock>
 TallyerClient::HandleKeyExchange(std::shared_ptr<NetworkDriver> network_driver,
                                  std::shared_ptr<CryptoDriver> crypto_driver) {
-  // Generate private/public DH keys
-  auto dh_values = crypto_driver->DH_initialize();
-
-  // Listen for g^a
+  // Listen for g^a, or for a ticket to resume an earlier session. If the
+  // ticket is declined, the user continues with g^a.
   std::vector<unsigned char> user_public_value = network_driver->read();
+  if (get_message_type(user_public_value) ==
+      MessageType::UserToServer_Resume_Message) {
+    UserToServer_Resume_Message resume_s;
+    resume_s.deserialize(user_public_value);
+    auto [reply_s, keys] = crypto_driver->SESSION_resume(
+        this->session_ticket_key, resume_s, this->common_config.aead_channel);
+    std::vector<unsigned char> reply_bytes;
+    reply_s.serialize(reply_bytes);
+    network_driver->send(reply_bytes);
+    if (reply_s.accepted) {
+      return keys;
+    }
+    user_public_value = network_driver->read();
+  }
   UserToServer_DHPublicValue_Message user_public_value_s;
   user_public_value_s.deserialize(user_public_value);
 
-  // Respond with m = (g^b, g^a) signed with our private RSA key
+  // Take private/public DH keys from the pool
+  auto dh_values = this->dh_pool->Pop();
+
+  // Recover g^ab
+  CryptoPP::SecByteBlock DH_shared_key = crypto_driver->DH_generate_shared_key(
+      std::get<0>(dh_values), std::get<1>(dh_values),
+      user_public_value_s.public_value);
+
+  // Respond with m = (g^b, g^a, mode) signed with our private RSA key
   ServerToUser_DHPublicValue_Message public_value_s;
   public_value_s.server_public_value = std::get<2>(dh_values);
   public_value_s.user_public_value = user_public_value_s.public_value;
+  public_value_s.channel_mode =
+      user_public_value_s.channel_mode == ChannelMode::AES_GCM &&
+              this->common_config.aead_channel
+          ? ChannelMode::AES_GCM
+          : ChannelMode::CBC_HMAC;
   public_value_s.server_signature = crypto_driver->RSA_sign(
-      this->RSA_tallyer_signing_key,
-      concat_byteblocks(public_value_s.server_public_value,
-                        public_value_s.user_public_value));
+      *this->RSA_tallyer_signer, concat_dh_values_and_mode(public_value_s));
+  if (this->common_config.session_ticket_lifetime > 0) {
+    public_value_s.session_ticket = crypto_driver->SESSION_seal_ticket(
+        this->session_ticket_key,
+        crypto_driver->SESSION_generate_secret(DH_shared_key),
+        this->common_config.session_ticket_lifetime);
+  }
 
   // Sign and send message
   std::vector<unsigned char> message_bytes;
   public_value_s.serialize(message_bytes);
   network_driver->send(message_bytes);
 
-  // Recover g^ab
-  CryptoPP::SecByteBlock DH_shared_key = crypto_driver->DH_generate_shared_key(
-      std::get<0>(dh_values), std::get<1>(dh_values),
-      user_public_value_s.public_value);
   CryptoPP::SecByteBlock AES_key =
       crypto_driver->AES_generate_key(DH_shared_key);
   CryptoPP::SecByteBlock HMAC_key =
       crypto_driver->HMAC_generate_key(DH_shared_key);
+  crypto_driver->set_channel_mode(public_value_s.channel_mode);
   return std::make_pair(AES_key, HMAC_key);
 }
 
@@ -153,10 +187,17 @@ TallyerClient::HandleKeyExchange(std::shared_ptr<NetworkDriver> network_driver,
  */
 void TallyerClient::HandleTally(std::shared_ptr<NetworkDriver> network_driver,
                                 std::shared_ptr<CryptoDriver> crypto_driver) {
-
   // TODO: implement me!
     // 1) Handles key exchange.
-    auto keys = HandleKeyExchange(network_driver, crypto_driver);
+    // A malformed key exchange message ends only this connection.
+    std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock> keys;
+    try {
+        keys = HandleKeyExchange(network_driver, crypto_driver);
+    } catch (std::runtime_error &e) {
+        this->cli_driver->print_warning(e.what());
+        network_driver->disconnect();
+        return;
+    }
     CryptoPP::SecByteBlock AES_key = keys.first;
     CryptoPP::SecByteBlock HMAC_key = keys.second;
     // 2) Receives a vote from the user, makes sure the user hasn't voted yet,
@@ -171,7 +212,13 @@ void TallyerClient::HandleTally(std::shared_ptr<NetworkDriver> network_driver,
 
     VoterToTallyer_Vote_Message v2t;
 
-    v2t.deserialize(v2t_data.first);
+    try {
+        v2t.deserialize(v2t_data.first);
+    } catch (std::runtime_error &e) {
+        this->cli_driver->print_warning(e.what());
+        network_driver->disconnect();
+        return;
+    }
 
     // makes sure the user hasn't voted yet,
     if(db_driver->vote_exists(v2t.votes)) {
@@ -189,23 +236,31 @@ void TallyerClient::HandleTally(std::shared_ptr<NetworkDriver> network_driver,
     // std::cout << v2t.unblinded_signatures.ints.size() << std::endl;
     // std::cout << v2t.zkps.zkp.size() << std::endl;
 
-    assert(this->t == v2t.unblinded_signatures.ints.size() && this->t == v2t.zkps.zkp.size() && "vector should have same size!");
+    assert((size_t)this->t == v2t.unblinded_signatures.ints.size() && (size_t)this->t == v2t.zkps.zkp.size() && "vector should have same size!");
+    std::vector<Serializable *> signed_votes;
+    for(int i = 0; i < this->t; i++) {
+        signed_votes.push_back(&v2t.votes.ct[i]);
+    }
+    std::vector<bool> signature_valid = crypto_driver->RSA_BLIND_verify_batch(*this->RSA_registrar_verifier, signed_votes, v2t.unblinded_signatures.ints);
+    if(std::find(signature_valid.begin(), signature_valid.end(), false) != signature_valid.end()) {
+        std::cerr<< "blind verification fails!"<<std::endl;
+        network_driver->disconnect();
+        return;
+    }
     for(int i = 0; i < this->t; i++) {
         Vote_Ciphertext vote = v2t.votes.ct[i];
         VoteZKP_Struct zkp = v2t.zkps.zkp[i];
-        CryptoPP::Integer unblinded_signature = v2t.unblinded_signatures.ints[i];
-        if(!crypto_driver->RSA_BLIND_verify(this->RSA_registrar_verification_key, vote, unblinded_signature)) {
-            std::cerr<< "blind verification fails!"<<std::endl;
-            network_driver->disconnect();
-            return;
-        }
-
         if(!ElectionClient::VerifyVoteZKP(std::make_pair(vote, zkp), this->EG_arbiter_public_key)) {
             std::cerr<< "SKP verification fails!"<<std::endl;
             network_driver->disconnect();
             return;
         }
     }
+    if(!ElectionClient::VerifyBallotSum(v2t.votes, v2t.zkps, this->EG_arbiter_public_key, this->common_config.min_votes, this->common_config.max_votes)) {
+        std::cerr<< "sum ZKP verification fails!"<<std::endl;
+        network_driver->disconnect();
+        return;
+    }
    
 
 
@@ -213,15 +268,8 @@ void TallyerClient::HandleTally(std::shared_ptr<NetworkDriver> network_driver,
     //4) Mark this user as having already voted.
     //need to be consistent to arbiter - HandleAdjudicate
 
-    std::vector<unsigned char> vote_cipher_data;
-    v2t.votes.serialize(vote_cipher_data);
-    std::vector<unsigned char> zkp_data;
-    v2t.zkps.serialize(zkp_data);
-    std::vector<unsigned char> signature_data;
-    v2t.unblinded_signatures.serialize(signature_data);
-
-    std::string sign_tallyer = chvec2str(vote_cipher_data) + chvec2str(zkp_data) +  chvec2str(signature_data);
-    std::string signature_tallyer = crypto_driver->RSA_sign(RSA_tallyer_signing_key, str2chvec(sign_tallyer)); //string
+    std::vector<unsigned char> sign_tallyer = concat_votes_zkps_and_signatures(v2t.votes, v2t.zkps, v2t.unblinded_signatures);
+    std::string signature_tallyer = crypto_driver->RSA_sign(*RSA_tallyer_signer, sign_tallyer); //string
     
     VoteRow t2w_msg;
     t2w_msg.votes = v2t.votes;
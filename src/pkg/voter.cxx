@@ -1,4 +1,8 @@
+#include <filesystem>
+#include <stdexcept>
+
 #include "../../include/pkg/voter.hpp"
+#include "../../include-shared/group.hpp"
 #include "../../include-shared/keyloaders.hpp"
 #include "../../include-shared/logger.hpp"
 #include "../../include/drivers/crypto_driver.hpp"
@@ -35,7 +39,8 @@ VoterClient::VoterClient(std::shared_ptr<NetworkDriver> network_driver,
 //   this->k = 5;
 //   assert(this->k <= this->t && "the allowed voting number is too large");
   initLogger();
-
+  ElectionClient::UseDiscreteLogTable(common_config.dlog_table_path);
+  ElectionClient::UseCompactProofs(common_config.compact_proofs);
 
   // Load election public key
   try {
@@ -46,6 +51,18 @@ VoterClient::VoterClient(std::shared_ptr<NetworkDriver> network_driver,
                                     "application may be non-functional.");
   }
 
+  // Fill the GenerateVote precomputation pool, starting with any tuples
+  // saved ahead of time.
+  if (!this->voter_config.voter_precompute_path.empty() &&
+      std::filesystem::exists(this->voter_config.voter_precompute_path)) {
+    ElectionClient::LoadVotePrecomputations(
+        this->voter_config.voter_precompute_path, this->EG_arbiter_public_key);
+  }
+  if (this->voter_config.voter_precompute_size > 0) {
+    ElectionClient::StartVotePrecomputation(
+        this->EG_arbiter_public_key, this->voter_config.voter_precompute_size);
+  }
+
   // Load registrar public key
   try {
     LoadRSAPublicKey(common_config.registrar_verification_key_path,
@@ -63,6 +80,10 @@ VoterClient::VoterClient(std::shared_ptr<NetworkDriver> network_driver,
     this->cli_driver->print_warning(
         "Error loading tallyer public key; application may be non-functional.");
   }
+  this->RSA_registrar_verifier =
+      std::make_shared<RSAVerifierHandle>(this->RSA_registrar_verification_key);
+  this->RSA_tallyer_verifier =
+      std::make_shared<RSAVerifierHandle>(this->RSA_tallyer_verification_key);
 
   // Load vote info (vote, zkp, registrar signature, and blind)
   // This is info voter should generate or receive after registering
@@ -103,25 +124,99 @@ void VoterClient::run() {
                   &VoterClient::HandleRegister);
   repl.add_action("vote", "vote <address> <port>", &VoterClient::HandleVote);
   repl.add_action("verify", "verify", &VoterClient::HandleVerify);
+  repl.add_action("precompute", "precompute <count>",
+                  &VoterClient::HandlePrecompute);
   repl.run();
 }
 
 /**
- * Key exchange with either registrar or tallyer
+ * Precompute ballot randomness for <count> votes and save it to
+ * voter_precompute_path; it is loaded into the pool on the next start.
+ */
+void VoterClient::HandlePrecompute(std::string input) {
+  std::vector<std::string> args = string_split(input, ' ');
+  long count = 0;
+  if (args.size() == 2) {
+    try {
+      size_t used;
+      count = std::stol(args[1], &used);
+      if (used != args[1].size()) {
+        count = 0;
+      }
+    } catch (const std::logic_error &) {
+      count = 0;
+    }
+  }
+  if (count <= 0 || this->voter_config.voter_precompute_path.empty()) {
+    this->cli_driver->print_warning("usage: precompute <count> (requires "
+                                    "voter_precompute_path in the config)");
+    return;
+  }
+  ElectionClient::SaveVotePrecomputations(
+      this->voter_config.voter_precompute_path, this->EG_arbiter_public_key,
+      count);
+  this->cli_driver->print_success("Saved precomputed votes.");
+}
+
+/**
+ * Key exchange with either registrar or tallyer, resuming the last session
+ * with that server when we hold a ticket for it
  */
 std::pair<CryptoPP::SecByteBlock, CryptoPP::SecByteBlock>
-VoterClient::HandleKeyExchange(CryptoPP::RSA::PublicKey verification_key) {
+VoterClient::HandleKeyExchange(const RSAVerifierHandle &verifier,
+                               SessionTicket &ticket) {
+  ChannelMode::T requested_mode = this->common_config.aead_channel
+                                      ? ChannelMode::AES_GCM
+                                      : ChannelMode::CBC_HMAC;
+
+  // Resume with the ticket from the last session, if we have one
+  if (!ticket.ticket.empty()) {
+    UserToServer_Resume_Message resume_s;
+    resume_s.session_ticket = ticket.ticket;
+    resume_s.client_nonce = this->crypto_driver->SESSION_generate_nonce();
+    resume_s.channel_mode = requested_mode;
+    std::vector<unsigned char> resume_data;
+    resume_s.serialize(resume_data);
+    this->network_driver->send(resume_data);
+
+    std::vector<unsigned char> reply_data = this->network_driver->read();
+    ServerToUser_Resume_Message reply_s;
+    reply_s.deserialize(reply_data);
+    if (reply_s.accepted) {
+      if (reply_s.channel_mode != ChannelMode::CBC_HMAC &&
+          reply_s.channel_mode != requested_mode) {
+        this->cli_driver->print_warning("Channel mode negotiation failed");
+        throw std::runtime_error(
+            "Voter: server chose a channel mode not offered.");
+      }
+      auto keys = this->crypto_driver->SESSION_derive_keys(
+          ticket.secret, resume_s.client_nonce, reply_s.server_nonce);
+      if (!this->crypto_driver->SESSION_verify_confirmation(
+              keys.second, resume_s.client_nonce, reply_s.server_nonce,
+              reply_s.channel_mode, reply_s.server_confirmation)) {
+        this->cli_driver->print_warning("Session resumption failed");
+        throw std::runtime_error(
+            "Voter: server could not confirm the resumed session.");
+      }
+      this->crypto_driver->set_channel_mode(reply_s.channel_mode);
+      return keys;
+    }
+    // Declined (expired, or the server restarted): full key exchange.
+    ticket = SessionTicket();
+  }
+
   // Generate private/public DH values
   auto dh_values = this->crypto_driver->DH_initialize();
 
   // Send g^a
   UserToServer_DHPublicValue_Message user_public_value_s;
   user_public_value_s.public_value = std::get<2>(dh_values);
+  user_public_value_s.channel_mode = requested_mode;
   std::vector<unsigned char> user_public_value_data;
   user_public_value_s.serialize(user_public_value_data);
   this->network_driver->send(user_public_value_data);
 
-  // 2) Receive m = (g^a, g^b) signed by the server
+  // 2) Receive m = (g^a, g^b, mode) signed by the server
   std::vector<unsigned char> server_public_value_data =
       this->network_driver->read();
   ServerToUser_DHPublicValue_Message server_public_value_s;
@@ -129,9 +224,7 @@ VoterClient::HandleKeyExchange(CryptoPP::RSA::PublicKey verification_key) {
 
   // Verify signature
   bool verified = this->crypto_driver->RSA_verify(
-      verification_key,
-      concat_byteblocks(server_public_value_s.server_public_value,
-                        server_public_value_s.user_public_value),
+      verifier, concat_dh_values_and_mode(server_public_value_s),
       server_public_value_s.server_signature);
   if (!verified) {
     this->cli_driver->print_warning("Signature verification failed");
@@ -142,6 +235,11 @@ VoterClient::HandleKeyExchange(CryptoPP::RSA::PublicKey verification_key) {
     throw std::runtime_error(
         "Voter: inconsistencies in voter public DH value.");
   }
+  if (server_public_value_s.channel_mode != ChannelMode::CBC_HMAC &&
+      server_public_value_s.channel_mode != user_public_value_s.channel_mode) {
+    this->cli_driver->print_warning("Channel mode negotiation failed");
+    throw std::runtime_error("Voter: server chose a channel mode not offered.");
+  }
 
   // Recover g^ab
   CryptoPP::SecByteBlock DH_shared_key = crypto_driver->DH_generate_shared_key(
@@ -151,6 +249,13 @@ VoterClient::HandleKeyExchange(CryptoPP::RSA::PublicKey verification_key) {
       crypto_driver->AES_generate_key(DH_shared_key);
   CryptoPP::SecByteBlock HMAC_key =
       crypto_driver->HMAC_generate_key(DH_shared_key);
+  this->crypto_driver->set_channel_mode(server_public_value_s.channel_mode);
+
+  // Keep the ticket so the next session can skip the key exchange
+  if (!server_public_value_s.session_ticket.empty()) {
+    ticket.ticket = server_public_value_s.session_ticket;
+    ticket.secret = crypto_driver->SESSION_generate_secret(DH_shared_key);
+  }
   return std::make_pair(AES_key, HMAC_key);
 }
 
@@ -185,7 +290,7 @@ void VoterClient::HandleRegister(std::string input) {
 
   // TODO: implement me!
     // 1) Handle key exchange.
-    auto keys = HandleKeyExchange(RSA_registrar_verification_key);
+    auto keys = HandleKeyExchange(*RSA_registrar_verifier, this->registrar_ticket);
     this->AES_key = keys.first;
     this->HMAC_key = keys.second;
 
@@ -194,13 +299,22 @@ void VoterClient::HandleRegister(std::string input) {
     this->t = 0;
 
 
-    for(auto &raw_vote: raw_votes) {
+    // 2) ElGamal encrypt the raw votes and generate their ZKPs, plus the
+    // sum ZKP if the election limits the number of candidates selected.
+    std::pair<Multi_Vote_Ciphertext, Multi_VoteZKP_Struct> ballot;
+    try {
+        ballot = ElectionClient::GenerateBallot(raw_votes, this->EG_arbiter_public_key, this->common_config.min_votes, this->common_config.max_votes);
+    } catch (std::runtime_error &e) {
+        this->cli_driver->print_warning(e.what());
+        this->network_driver->disconnect();
+        return;
+    }
+    this->vote_zkps.sum = ballot.second.sum;
+
+    for(size_t i = 0; i < ballot.first.ct.size(); i++) {
         this->t ++;
-        // 2) ElGamal encrypt the raw vote and generate a ZKP for it
-        // through `ElectionClient::GenerateVote`.
-        std::pair<Vote_Ciphertext, VoteZKP_Struct> encrypted_vote_and_zkp = ElectionClient::GenerateVote(raw_vote, this->EG_arbiter_public_key);
-        Vote_Ciphertext vote_s = encrypted_vote_and_zkp.first;
-        VoteZKP_Struct vote_zkp = encrypted_vote_and_zkp.second;
+        Vote_Ciphertext vote_s = ballot.first.ct[i];
+        VoteZKP_Struct vote_zkp = ballot.second.zkp[i];
         // std::cout<<"EN RESULT:"<<" ";
         // std::vector<unsigned char> en_data_vote;
         // vote_s.serialize(en_data_vote);
@@ -280,7 +394,7 @@ void VoterClient::HandleVote(std::string input) {
   // TODO: implement me!
     // std::cout<<"Handle vote!"<<std::endl;
     //1) Handles key exchange.
-    auto keys = HandleKeyExchange(RSA_tallyer_verification_key);//todo: which verification key, when registering?
+    auto keys = HandleKeyExchange(*RSA_tallyer_verifier, this->tallyer_ticket);//todo: which verification key, when registering?
     this->AES_key = keys.first;
     this->HMAC_key = keys.second;
     // std::cout<<"unbind registrar!"<<std::endl;
@@ -368,7 +482,7 @@ std::pair<bool, std::vector<CryptoPP::Integer>> VoterClient::DoVerify() {
     //check every voter:
     for (auto it = votes.begin(); it != votes.end(); ) {
         auto &vMsg = *it;
-        if(!crypto_driver->RSA_verify(RSA_tallyer_verification_key, 
+        if(!crypto_driver->RSA_verify(*RSA_tallyer_verifier, 
             concat_votes_zkps_and_signatures(vMsg.votes, vMsg.zkps, vMsg.unblinded_signatures), vMsg.tallyer_signatures)) {
             it = votes.erase(it);
             std::cout<<"RSA VERIFY FAILED!"<<std::endl;
@@ -378,32 +492,46 @@ std::pair<bool, std::vector<CryptoPP::Integer>> VoterClient::DoVerify() {
     }
     // std::cout<<"check votes!"<<std::endl;
 
-    //check every voter's single vote and combine them
-    std::vector<Vote_Ciphertext> combine_votes;
-    for(int i = 0; i < this->t; i++) { // 对于每一纵列（candidate），按照原有的程序进行
-        Vote_Ciphertext combine_vote;
-        combine_vote.a = 1;
-        combine_vote.b = 1;
-        for(auto &vMsg: votes) {
-            Vote_Ciphertext vote = vMsg.votes.ct[i];
-            VoteZKP_Struct zkp = vMsg.zkps.zkp[i];
-            CryptoPP::Integer unblinded_signature = vMsg.unblinded_signatures.ints[i];
-            if(!ElectionClient::VerifyVoteZKP(std::make_pair(vote, zkp), this->EG_arbiter_public_key)) {
+    //check every voter's vote and sum ZKPs in one batch
+    std::vector<bool> ballot_valid = ElectionClient::VerifyBallotBatch(votes, this->EG_arbiter_public_key, this->common_config.min_votes, this->common_config.max_votes);
+
+    //check every registrar signature in one batch, in (candidate, voter) order
+    std::vector<Serializable *> signed_votes;
+    std::vector<CryptoPP::Integer> unblinded_signatures;
+    for(int i = 0; i < this->t; i++) {
+        for(size_t j = 0; j < votes.size(); j++) {
+            signed_votes.push_back(&votes[j].votes.ct[i]);
+            unblinded_signatures.push_back(votes[j].unblinded_signatures.ints[i]);
+        }
+    }
+    std::vector<bool> signature_valid = crypto_driver->RSA_BLIND_verify_batch(*RSA_registrar_verifier, signed_votes, unblinded_signatures);
+
+    //check every voter's single vote; invalid ones are counted as the identity
+    Vote_Ciphertext identity;
+    identity.a = ElectionGroup()->Identity();
+    identity.b = ElectionGroup()->Identity();
+    for(int i = 0; i < this->t; i++) {
+        for(size_t j = 0; j < votes.size(); j++) {
+            auto &vMsg = votes[j];
+            Vote_Ciphertext &vote = vMsg.votes.ct[i];
+            if(!ballot_valid[j]) {
                 std::cout<<"ZKP VERIFY FAILED!"<<std::endl;
+                vote = identity;
                 continue;
             }
-            if(!crypto_driver->RSA_BLIND_verify(RSA_registrar_verification_key, vote, unblinded_signature)) {
+            if(!signature_valid[i * votes.size() + j]) {
                 std::cout<<"registrar VERIFY FAILED!"<<std::endl;
+                vote = identity;
                 continue;    
             } 
-            combine_vote.a = a_times_b_mod_c(combine_vote.a, vote.a, DL_P);
-            combine_vote.b = a_times_b_mod_c(combine_vote.b, vote.b, DL_P);
         }
-       combine_votes.push_back(combine_vote);
-    }    
+    }
+    //combine them
+    std::vector<Vote_Ciphertext> combine_votes = ElectionClient::CombineVotes(votes, this->t);
     // std::cout<<"start partial dec!"<<std::endl;
 
     std::vector<CryptoPP::Integer> res;
+    std::vector<std::vector<PartialDecryptionRow>> all_valid_partial_decryptions;
     for(int i = 0; i < this->t; i ++) {
         std::vector<PartialDecryptionRow> partial_dec = db_driver->row_partial_decryptions(i); //这里改了，对于第i列（也就是第i个candidate），求取它的情况
         std::vector<PartialDecryptionRow> valid_partial_decryptions;
@@ -417,9 +545,13 @@ std::pair<bool, std::vector<CryptoPP::Integer>> VoterClient::DoVerify() {
 
             valid_partial_decryptions.push_back(dec_msg);
         }
-        
-        Vote_Ciphertext combine_vote = combine_votes[i];
-        CryptoPP::Integer ret = ElectionClient::CombineResults(combine_vote, valid_partial_decryptions);
+        all_valid_partial_decryptions.push_back(valid_partial_decryptions);
+    }
+
+    // all candidates are combined together so the inversions can be batched
+    std::vector<CryptoPP::Integer> results = ElectionClient::CombineResultsBatch(combine_votes, all_valid_partial_decryptions);
+    for(int i = 0; i < this->t; i ++) {
+        CryptoPP::Integer ret = results[i];
         if(ret == -1) {
             std::cout<<"error for finding the final result!"<<std::endl;
             return std::make_pair(false, res);
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include <crypto++/nbtheory.h>
+
+#include "../include-shared/rng.hpp"
+#include "../include/drivers/crypto_driver.hpp"
+
+namespace {
+// Smaller than RSA_KEYSIZE to keep key generation quick.
+const unsigned int TEST_RSA_BITS = 1024;
+
+/**
+ * A message to sign; distinct for distinct i.
+ */
+Vote_Ciphertext blind_message(long i) {
+  Vote_Ciphertext msg;
+  msg.a = CryptoPP::Integer(i + 2);
+  msg.b = CryptoPP::Integer(i + 3);
+  return msg;
+}
+
+/**
+ * FDH hash of msg mod n, as RSA_BLIND_verify computes it.
+ */
+CryptoPP::Integer blind_hash(CryptoDriver &crypto_driver, Serializable &msg,
+                             const CryptoPP::Integer &n) {
+  std::vector<unsigned char> data;
+  msg.serialize(data);
+  SecByteBlock hash = crypto_driver.FDH_hash(
+      SecByteBlock(data.data(), data.size()), n.ByteCount());
+  return CryptoPP::Integer(hash.data(), hash.size()) % n;
+}
+
+/**
+ * Blind, sign and unblind msg.
+ */
+CryptoPP::Integer blind_signature(CryptoDriver &crypto_driver,
+                                  const RSA::PrivateKey &sk,
+                                  const RSA::PublicKey &pk, Serializable &msg) {
+  auto [blinded, blind] = crypto_driver.RSA_BLIND_blind(pk, msg);
+  CryptoPP::Integer signed_blinded = crypto_driver.RSA_BLIND_sign(sk, blinded);
+  return crypto_driver.RSA_BLIND_unblind(pk, signed_blinded, blind);
+}
+
+/**
+ * A key pair with public exponent e.
+ */
+std::pair<RSA::PrivateKey, RSA::PublicKey>
+rsa_keys(const CryptoPP::Integer &e) {
+  RSA::PrivateKey sk;
+  sk.Initialize(ThreadRNG(), TEST_RSA_BITS, e);
+  RSA::PublicKey pk;
+  pk.AssignFrom(sk);
+  return {sk, pk};
+}
+
+/**
+ * Sign count messages and verify them as one batch after tamper() has had
+ * a chance to change the signatures.
+ */
+template <typename Tamper>
+std::vector<bool> verify_batch(const RSA::PrivateKey &sk,
+                               const RSA::PublicKey &pk, size_t count,
+                               Tamper tamper) {
+  CryptoDriver crypto_driver;
+  std::vector<Vote_Ciphertext> msgs;
+  for (size_t i = 0; i < count; i++) {
+    msgs.push_back(blind_message(i));
+  }
+  std::vector<Serializable *> msg_ptrs;
+  std::vector<CryptoPP::Integer> signatures;
+  for (Vote_Ciphertext &msg : msgs) {
+    msg_ptrs.push_back(&msg);
+    signatures.push_back(blind_signature(crypto_driver, sk, pk, msg));
+  }
+  tamper(signatures, pk.GetModulus());
+  return crypto_driver.RSA_BLIND_verify_batch(pk, msg_ptrs, signatures);
+}
+/**
+ * A fresh random key of AES-256 size.
+ */
+SecByteBlock random_key() {
+  SecByteBlock key(32);
+  ThreadRNG().GenerateBlock(key.data(), key.size());
+  return key;
+}
+} // namespace
+
+TEST_CASE("blind signatures verify singly and in batches") {
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  Vote_Ciphertext msg = blind_message(0);
+  CryptoPP::Integer signature = blind_signature(crypto_driver, sk, pk, msg);
+  CHECK(crypto_driver.RSA_BLIND_verify(pk, msg, signature));
+
+  std::vector<bool> valid = verify_batch(
+      sk, pk, 3 * MODEXP_LANES + 1,
+      [](std::vector<CryptoPP::Integer> &, const CryptoPP::Integer &) {});
+  CHECK(valid == std::vector<bool>(3 * MODEXP_LANES + 1, true));
+}
+
+TEST_CASE("blind signature checks reject out-of-range signatures") {
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  const CryptoPP::Integer &n = pk.GetModulus();
+  Vote_Ciphertext msg = blind_message(0);
+  CryptoPP::Integer signature = blind_signature(crypto_driver, sk, pk, msg);
+  CHECK_FALSE(crypto_driver.RSA_BLIND_verify(pk, msg, signature + n));
+  CHECK_FALSE(crypto_driver.RSA_BLIND_verify(pk, msg, signature - n));
+  CHECK_FALSE(
+      crypto_driver.RSA_BLIND_verify(pk, msg, CryptoPP::Integer::Zero()));
+
+  std::vector<bool> valid = verify_batch(
+      sk, pk, 4,
+      [](std::vector<CryptoPP::Integer> &signatures,
+         const CryptoPP::Integer &n) {
+        signatures[1] += n;
+        signatures[2] = CryptoPP::Integer::Zero();
+      });
+  CHECK(valid == std::vector<bool>{true, false, false, true});
+}
+
+TEST_CASE("batch blind verification reports only the bad pairs") {
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  std::vector<bool> valid = verify_batch(
+      sk, pk, 2 * MODEXP_LANES + 3,
+      [](std::vector<CryptoPP::Integer> &signatures,
+         const CryptoPP::Integer &n) {
+        signatures[5] = (signatures[5] + 1) % n;
+      });
+  for (size_t i = 0; i < valid.size(); i++) {
+    CHECK(valid[i] == (i != 5));
+  }
+}
+
+TEST_CASE("batch blind verification rejects sign-flipped pairs") {
+  // -s1, -s2 multiply to the same product as s1, s2.
+  auto flip = [](std::vector<CryptoPP::Integer> &signatures,
+                 const CryptoPP::Integer &n) {
+    signatures[0] = n - signatures[0];
+    signatures[1] = n - signatures[1];
+  };
+
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  std::vector<bool> valid = verify_batch(sk, pk, 4, flip);
+  CHECK(valid == std::vector<bool>{false, false, true, true});
+
+  // An exponent wider than the screen's, and a key whose modulus lets the
+  // screen run, so the randomized path is the one under test.
+  CryptoPP::Integer wide_e = CryptoPP::Integer::Power2(89) - 1; // prime
+  for (int attempt = 0; attempt < 32; attempt++) {
+    auto [wide_sk, wide_pk] = rsa_keys(wide_e);
+    if (!RSAVerifierHandle(wide_pk).CanScreenBatches()) {
+      continue;
+    }
+    std::vector<bool> wide_valid = verify_batch(
+        wide_sk, wide_pk, 2 * MODEXP_LANES + 2,
+        [&](std::vector<CryptoPP::Integer> &signatures,
+            const CryptoPP::Integer &n) {
+          flip(signatures, n);
+          signatures[9] = (signatures[9] * 2) % n;
+        });
+    for (size_t i = 0; i < wide_valid.size(); i++) {
+      CHECK(wide_valid[i] == (i != 0 && i != 1 && i != 9));
+    }
+    break;
+  }
+}
+
+TEST_CASE("batch blind verification rejects repeated-message forgeries") {
+  // With e = 17, seventeen copies of m signed (H(m), 1, ..., 1) satisfy
+  // (prod s_i)^e == prod H(m) without the private key.
+  auto [sk, pk] = rsa_keys(CryptoPP::Integer(17));
+  const CryptoPP::Integer &n = pk.GetModulus();
+  CryptoDriver crypto_driver;
+  Vote_Ciphertext msg = blind_message(0);
+  std::vector<Serializable *> msgs(17, &msg);
+  std::vector<CryptoPP::Integer> signatures(17, CryptoPP::Integer::One());
+  signatures[0] = blind_hash(crypto_driver, msg, n);
+  std::vector<bool> valid =
+      crypto_driver.RSA_BLIND_verify_batch(pk, msgs, signatures);
+  CHECK(valid == std::vector<bool>(17, false));
+
+  // The genuine signature is still accepted each time it repeats.
+  std::fill(signatures.begin(), signatures.end(),
+            blind_signature(crypto_driver, sk, pk, msg));
+  valid = crypto_driver.RSA_BLIND_verify_batch(pk, msgs, signatures);
+  CHECK(valid == std::vector<bool>(17, true));
+}
+
+TEST_CASE("key-based RSA calls agree across keys") {
+  CryptoDriver crypto_driver;
+  std::vector<unsigned char> message = {'v', 'o', 't', 'e'};
+  auto [sk1, pk1] = crypto_driver.RSA_generate_keys();
+  auto [sk2, pk2] = crypto_driver.RSA_generate_keys();
+  for (int round = 0; round < 2; round++) {
+    std::string signature = crypto_driver.RSA_sign(sk1, message);
+    CHECK(crypto_driver.RSA_verify(pk1, message, signature));
+    CHECK_FALSE(crypto_driver.RSA_verify(pk2, message, signature));
+    signature = crypto_driver.RSA_sign(sk2, message);
+    CHECK(crypto_driver.RSA_verify(pk2, message, signature));
+    CHECK_FALSE(crypto_driver.RSA_verify(pk1, message, signature));
+  }
+}
+
+TEST_CASE("CRT blind signing matches the plain private exponent") {
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  const CryptoPP::Integer &n = pk.GetModulus();
+  RSASignerHandle signer(sk);
+  for (int i = 0; i < 4; i++) {
+    CryptoPP::Integer c(ThreadRNG(), CryptoPP::Integer::One(), n - 1);
+    CryptoPP::Integer s = signer.BlindSign(c);
+    CHECK(s == CryptoPP::ModularExponentiation(c, sk.GetPrivateExponent(), n));
+    CHECK(pk.ApplyFunction(s) == c);
+  }
+}
+
+TEST_CASE("CRT blind signing refuses to release a faulty signature") {
+  // A key whose CRT exponent is off stands in for a fault in one half.
+  CryptoDriver crypto_driver;
+  auto [sk, pk] = crypto_driver.RSA_generate_keys();
+  RSA::PrivateKey faulty = sk;
+  faulty.SetModPrime1PrivateExponent(sk.GetModPrime1PrivateExponent() + 2);
+  RSASignerHandle signer(faulty);
+  CryptoPP::Integer c(ThreadRNG(), CryptoPP::Integer::One(),
+                      pk.GetModulus() - 1);
+  CHECK_THROWS_AS(signer.BlindSign(c), std::runtime_error);
+}
+
+TEST_CASE("channel messages round-trip in either mode") {
+  SecByteBlock aes_key = random_key();
+  SecByteBlock hmac_key = random_key();
+  Vote_Ciphertext msg = blind_message(7);
+  std::vector<unsigned char> plaintext;
+  msg.serialize(plaintext);
+  for (ChannelMode::T mode : {ChannelMode::CBC_HMAC, ChannelMode::AES_GCM}) {
+    CryptoDriver crypto_driver;
+    crypto_driver.set_channel_mode(mode);
+    CHECK(crypto_driver.get_channel_mode() == mode);
+    std::vector<unsigned char> frame =
+        crypto_driver.encrypt_and_tag(aes_key, hmac_key, &msg);
+    auto [decrypted, ok] =
+        crypto_driver.decrypt_and_verify(aes_key, hmac_key, frame);
+    CHECK(ok);
+    CHECK(decrypted == plaintext);
+  }
+}
+
+TEST_CASE("AES-GCM frames fail when tampered, truncated or under another key") {
+  CryptoDriver crypto_driver;
+  crypto_driver.set_channel_mode(ChannelMode::AES_GCM);
+  SecByteBlock key = random_key();
+  Vote_Ciphertext msg = blind_message(7);
+  std::vector<unsigned char> frame =
+      crypto_driver.encrypt_and_tag(key, SecByteBlock(), &msg);
+
+  // The type byte, nonce, ciphertext and tag are all authenticated.
+  for (size_t i : {size_t(0), size_t(1), frame.size() / 2, frame.size() - 1}) {
+    std::vector<unsigned char> tampered = frame;
+    tampered[i] ^= 1;
+    auto [decrypted, ok] = crypto_driver.AEAD_decrypt(key, tampered);
+    CHECK_FALSE(ok);
+    CHECK(decrypted.empty());
+  }
+  for (size_t length : {size_t(0), size_t(5), frame.size() - 1}) {
+    std::vector<unsigned char> truncated(frame.begin(),
+                                         frame.begin() + length);
+    CHECK_FALSE(crypto_driver.AEAD_decrypt(key, truncated).second);
+  }
+  CHECK_FALSE(crypto_driver.AEAD_decrypt(random_key(), frame).second);
+}
+
+TEST_CASE("CBC channel frames fail when their MAC does not match") {
+  CryptoDriver crypto_driver;
+  SecByteBlock aes_key = random_key();
+  SecByteBlock hmac_key = random_key();
+  Vote_Ciphertext msg = blind_message(7);
+  std::vector<unsigned char> frame =
+      crypto_driver.encrypt_and_tag(aes_key, hmac_key, &msg);
+  CHECK_FALSE(
+      crypto_driver.decrypt_and_verify(aes_key, random_key(), frame).second);
+}
+
+TEST_CASE("session tickets open only under their key, intact and unexpired") {
+  CryptoDriver crypto_driver;
+  SecByteBlock key = crypto_driver.SESSION_generate_ticket_key();
+  SecByteBlock secret = crypto_driver.SESSION_generate_ticket_key();
+  std::string ticket = crypto_driver.SESSION_seal_ticket(key, secret, 3600);
+  auto [opened, ok] = crypto_driver.SESSION_open_ticket(key, ticket);
+  CHECK(ok);
+  CHECK(opened == secret);
+
+  SecByteBlock other_key = crypto_driver.SESSION_generate_ticket_key();
+  CHECK_FALSE(crypto_driver.SESSION_open_ticket(other_key, ticket).second);
+
+  // Every byte, from nonce to tag, is covered.
+  for (size_t i : {size_t(0), ticket.size() / 2, ticket.size() - 1}) {
+    std::string tampered = ticket;
+    tampered[i] ^= 1;
+    CHECK_FALSE(crypto_driver.SESSION_open_ticket(key, tampered).second);
+  }
+  for (size_t length : {size_t(0), size_t(8), ticket.size() - 1}) {
+    CHECK_FALSE(
+        crypto_driver.SESSION_open_ticket(key, ticket.substr(0, length))
+            .second);
+  }
+
+  std::string expired = crypto_driver.SESSION_seal_ticket(key, secret, -1);
+  CHECK_FALSE(crypto_driver.SESSION_open_ticket(key, expired).second);
+}
+
+TEST_CASE("servers resume only sessions with a ticket they can open") {
+  CryptoDriver client;
+  SecByteBlock key = client.SESSION_generate_ticket_key();
+  SecByteBlock secret = client.SESSION_generate_ticket_key();
+  UserToServer_Resume_Message resume;
+  resume.session_ticket = client.SESSION_seal_ticket(key, secret, 3600);
+  resume.client_nonce = client.SESSION_generate_nonce();
+  resume.channel_mode = ChannelMode::AES_GCM;
+
+  for (bool allow_aead : {false, true}) {
+    CryptoDriver server;
+    auto [reply, keys] = server.SESSION_resume(key, resume, allow_aead);
+    REQUIRE(reply.accepted);
+    ChannelMode::T mode =
+        allow_aead ? ChannelMode::AES_GCM : ChannelMode::CBC_HMAC;
+    CHECK(reply.channel_mode == mode);
+    CHECK(server.get_channel_mode() == mode);
+
+    // The client derives the same keys and accepts the confirmation.
+    auto client_keys = client.SESSION_derive_keys(secret, resume.client_nonce,
+                                                  reply.server_nonce);
+    CHECK(client_keys.first == keys.first);
+    CHECK(client_keys.second == keys.second);
+    CHECK(client.SESSION_verify_confirmation(
+        client_keys.second, resume.client_nonce, reply.server_nonce,
+        reply.channel_mode, reply.server_confirmation));
+  }
+
+  CryptoDriver server;
+  CHECK_FALSE(server.SESSION_resume(client.SESSION_generate_ticket_key(),
+                                    resume, true)
+                  .first.accepted);
+  UserToServer_Resume_Message short_nonce = resume;
+  short_nonce.client_nonce = SecByteBlock(8);
+  CHECK_FALSE(server.SESSION_resume(key, short_nonce, true).first.accepted);
+  CHECK(server.get_channel_mode() == ChannelMode::CBC_HMAC);
+}
+
+TEST_CASE("DH key pools hand out fresh, working key pairs") {
+  CryptoDriver crypto_driver;
+  for (size_t size : {0, 3}) {
+    DHKeyPool pool(size, 1);
+    std::vector<SecByteBlock> publics;
+    for (int i = 0; i < 6; i++) {
+      auto [dh, private_value, public_value] = pool.Pop();
+      CHECK(std::find(publics.begin(), publics.end(), public_value) ==
+            publics.end());
+      publics.push_back(public_value);
+
+      // Every pair agrees on a shared key with a freshly made one.
+      auto [other_dh, other_private, other_public] =
+          crypto_driver.DH_initialize();
+      CHECK(crypto_driver.DH_generate_shared_key(dh, private_value,
+                                                 other_public) ==
+            crypto_driver.DH_generate_shared_key(other_dh, other_private,
+                                                 public_value));
+    }
+  }
+}
+
+TEST_CASE("DH key pools stop without waiting out the refill interval") {
+  auto start = std::chrono::steady_clock::now();
+  {
+    DHKeyPool pool(4, 60 * 60 * 1000);
+    pool.Pop();
+  }
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::minutes(1));
+}
@@ -0,0 +1,164 @@
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include <crypto++/nbtheory.h>
+
+#include "../include-shared/constants.hpp"
+#include "../include-shared/crypto_math.hpp"
+#include "../include-shared/rng.hpp"
+
+namespace {
+/**
+ * A random odd modulus of the given width.
+ */
+CryptoPP::Integer odd_modulus(size_t bits) {
+  CryptoPP::Integer m(ThreadRNG(), bits);
+  m.SetBit(bits - 1);
+  m.SetBit(0);
+  return m;
+}
+} // namespace
+
+TEST_CASE("Montgomery contexts of different sizes never share a workspace") {
+  // Contexts made and destroyed in turn tend to reuse one address.
+  for (size_t bits : {2048, 256, 1024, 64, 2048, 512}) {
+    CryptoPP::Integer m = odd_modulus(bits);
+    auto context = std::make_unique<MontgomeryContext>(m);
+    CryptoPP::Integer x(ThreadRNG(), CryptoPP::Integer::Zero(), m - 1);
+    CryptoPP::Integer y(ThreadRNG(), CryptoPP::Integer::Zero(), m - 1);
+    CryptoPP::Integer product = context->ConvertOut(
+        context->Multiply(context->ConvertIn(x), context->ConvertIn(y)));
+    CHECK(product == CryptoPP::a_times_b_mod_c(x, y, m));
+    CHECK(context->ConvertOut(context->Square(context->ConvertIn(x))) ==
+          CryptoPP::a_times_b_mod_c(x, x, m));
+  }
+}
+
+TEST_CASE("BatchExponentiate matches one exponentiation at a time") {
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  // Moduli with a bound that exponents reach and pass: the MODP group with
+  // its order, then random odd moduli.
+  std::vector<std::pair<CryptoPP::Integer, CryptoPP::Integer>> moduli = {
+      {DL_P, DL_Q}};
+  for (size_t bits : {64, 256, 1024, 2048}) {
+    CryptoPP::Integer m = odd_modulus(bits);
+    moduli.push_back(
+        {m, CryptoPP::Integer(rng, CryptoPP::Integer::One(), m - 1)});
+  }
+  for (const auto &[m, bound] : moduli) {
+    // Counts below, at and past a multiple of MODEXP_LANES.
+    for (size_t count : {size_t(1), MODEXP_LANES, 2 * MODEXP_LANES + 3}) {
+      std::vector<CryptoPP::Integer> bases, exponents;
+      for (size_t i = 0; i < count; i++) {
+        bases.push_back(
+            CryptoPP::Integer(rng, CryptoPP::Integer::Zero(), m - 1));
+        exponents.push_back(
+            CryptoPP::Integer(rng, CryptoPP::Integer::Zero(), bound - 1));
+      }
+      exponents[0] = CryptoPP::Integer::Zero();
+      if (count > 1) {
+        exponents[1] = bound;
+        exponents[count - 1] += bound;
+        bases[count - 1] += m; // reduced before use
+      }
+      if (count > 3) {
+        exponents[2] = CryptoPP::Integer::One();
+        bases[3] = CryptoPP::Integer::Zero();
+      }
+      std::vector<CryptoPP::Integer> powers =
+          BatchExponentiate(bases, exponents, m);
+      REQUIRE(powers.size() == count);
+      for (size_t i = 0; i < count; i++) {
+        CHECK(powers[i] ==
+              CryptoPP::a_exp_b_mod_c(bases[i], exponents[i], m));
+        CHECK(powers[i] ==
+              CryptoPP::ModularExponentiation(bases[i], exponents[i], m));
+      }
+    }
+  }
+}
+
+TEST_CASE("fixed-base tables agree with plain exponentiation") {
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  CryptoPP::Integer h = CryptoPP::ModularExponentiation(
+      DL_G, CryptoPP::Integer(rng, CryptoPP::Integer::One(), DL_Q - 1), DL_P);
+  for (const CryptoPP::Integer &base : {DL_G, h}) {
+    for (unsigned int window_bits : {1, 5, 8}) {
+      FixedBaseTable table(base, DL_P, DL_Q, window_bits);
+      CHECK(table.GetBase() == base);
+      std::vector<CryptoPP::Integer> exponents = {
+          CryptoPP::Integer::Zero(), CryptoPP::Integer::One(), DL_Q - 1,
+          CryptoPP::Integer(rng, CryptoPP::Integer::Zero(), DL_Q - 1)};
+      for (const CryptoPP::Integer &e : exponents) {
+        CHECK(table.Exponentiate(e) ==
+              CryptoPP::ModularExponentiation(base, e, DL_P));
+      }
+      // Exponents outside [0, q) are reduced, as the base has order q.
+      CHECK(table.Exponentiate(DL_Q) == CryptoPP::Integer::One());
+      CHECK(table.Exponentiate(DL_Q + 5) ==
+            table.Exponentiate(CryptoPP::Integer(5)));
+      CHECK(table.Exponentiate(CryptoPP::Integer(-1)) ==
+            table.Exponentiate(DL_Q - 1));
+    }
+  }
+}
+
+TEST_CASE("Montgomery products match plain modular products") {
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  for (const CryptoPP::Integer &m : {DL_P, odd_modulus(256)}) {
+    auto context = std::make_shared<const MontgomeryContext>(m);
+    MontgomeryProduct empty(context);
+    CHECK(empty.Value() == CryptoPP::Integer::One());
+
+    MontgomeryProduct first(context), second(context);
+    CryptoPP::Integer expected_first = CryptoPP::Integer::One();
+    CryptoPP::Integer expected_second = CryptoPP::Integer::One();
+    for (int i = 0; i < 20; i++) {
+      CryptoPP::Integer x(rng, CryptoPP::Integer::Zero(), m - 1);
+      first.Multiply(x);
+      expected_first = CryptoPP::a_times_b_mod_c(expected_first, x, m);
+    }
+    // Factors outside [0, m) are reduced first.
+    for (const CryptoPP::Integer &x :
+         {m + 3, CryptoPP::Integer(-5), CryptoPP::Integer(7)}) {
+      second.Multiply(x);
+      expected_second = CryptoPP::a_times_b_mod_c(
+          expected_second, (x % m + m) % m, m);
+    }
+    CHECK(first.Value() == expected_first);
+    CHECK(second.Value() == expected_second);
+
+    first.Multiply(second);
+    CHECK(first.Value() ==
+          CryptoPP::a_times_b_mod_c(expected_first, expected_second, m));
+  }
+}
+
+TEST_CASE("BatchInverse inverts every element or throws") {
+  CryptoPP::RandomNumberGenerator &rng = ThreadRNG();
+  CHECK(BatchInverse({}, DL_P).empty());
+  for (size_t count : {1, 2, 17}) {
+    std::vector<CryptoPP::Integer> xs;
+    for (size_t i = 0; i < count; i++) {
+      xs.push_back(CryptoPP::Integer(rng, CryptoPP::Integer::One(), DL_P - 1));
+    }
+    xs[0] += DL_P; // reduced before use
+    std::vector<CryptoPP::Integer> inverses = BatchInverse(xs, DL_P);
+    REQUIRE(inverses.size() == count);
+    for (size_t i = 0; i < count; i++) {
+      CHECK(inverses[i] == CryptoPP::EuclideanMultiplicativeInverse(
+                               xs[i] % DL_P, DL_P));
+    }
+  }
+
+  // One element without an inverse spoils the whole batch.
+  std::vector<CryptoPP::Integer> xs = {CryptoPP::Integer(3), DL_P,
+                                       CryptoPP::Integer(5)};
+  CHECK_THROWS_AS(BatchInverse(xs, DL_P), std::invalid_argument);
+  CryptoPP::Integer m = CryptoPP::Integer(3) * CryptoPP::Integer(11);
+  xs = {CryptoPP::Integer(2), CryptoPP::Integer(22)};
+  CHECK_THROWS_AS(BatchInverse(xs, m), std::invalid_argument);
+}
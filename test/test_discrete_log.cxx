@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "doctest/doctest.h"
+
+#include "../include-shared/constants.hpp"
+#include "../include-shared/discrete_log.hpp"
+#include "../include-shared/group.hpp"
+
+namespace {
+/**
+ * A path in the temporary directory for a table file.
+ */
+std::string table_path(const std::string &name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+/**
+ * Whether table solves g^x for every x in [0, max_exponent), and nothing at
+ * or past it.
+ */
+bool solves_range(const Group &group, const DiscreteLogTable &table,
+                  long max_exponent) {
+  for (long x = 0; x < max_exponent + 3; x++) {
+    CryptoPP::Integer exponent;
+    bool solved = table.Solve(group.ExpGenerator(CryptoPP::Integer(x)),
+                              max_exponent, exponent);
+    if (solved != (x < max_exponent) ||
+        (solved && exponent != CryptoPP::Integer(x))) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+TEST_CASE("baby-step giant-step recovers small exponents") {
+  for (const char *name : {GROUP_MODP_2048, GROUP_SECP256R1}) {
+    std::shared_ptr<const Group> group = MakeGroup(name);
+    DiscreteLogTable table(group, 8);
+    CHECK(table.GetBabySteps() == 8);
+    // Below, at and past a multiple of the baby steps.
+    CHECK(solves_range(*group, table, 7));
+    CHECK(solves_range(*group, table, 8));
+    CHECK(solves_range(*group, table, 29));
+  }
+}
+
+TEST_CASE("baby-step giant-step finds nothing outside the group or range") {
+  std::shared_ptr<const Group> group = MakeGroup(GROUP_MODP_2048);
+  DiscreteLogTable table(group, 8);
+  CryptoPP::Integer exponent;
+  CHECK_FALSE(table.Solve(DL_P - 1, 64, exponent));
+  CHECK_FALSE(table.Solve(CryptoPP::Integer::Zero(), 64, exponent));
+  CHECK_FALSE(table.Solve(
+      group->ExpGenerator(CryptoPP::Integer(1000000)), 64, exponent));
+}
+
+TEST_CASE("discrete log tables load only for their own group and size") {
+  std::shared_ptr<const Group> group = MakeGroup(GROUP_MODP_2048);
+  std::string path = table_path("test_discrete_log.bin");
+  DiscreteLogTable(group, 16).Save(path);
+
+  std::shared_ptr<DiscreteLogTable> loaded =
+      DiscreteLogTable::Load(path, group);
+  CHECK(loaded->GetBabySteps() == 16);
+  CHECK(solves_range(*group, *loaded, 40));
+
+  CHECK_THROWS_AS(DiscreteLogTable::Load(path, MakeGroup(GROUP_SECP256R1)),
+                  std::runtime_error);
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+  CHECK_THROWS_AS(DiscreteLogTable::Load(path, group), std::runtime_error);
+  std::filesystem::remove(path);
+}
+
+TEST_CASE("discrete log tables reject step counts that wrap the file size") {
+  std::shared_ptr<const Group> group = MakeGroup(GROUP_MODP_2048);
+  std::string path = table_path("test_discrete_log_forged.bin");
+  DiscreteLogTable(group, 16).Save(path);
+
+  // 16 + 2^60 entries of 16 bytes wrap around to the 16 in the file. The
+  // step count follows the 8-byte magic and the 8-byte version.
+  uint64_t forged = 16 + (uint64_t(1) << 60);
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(16);
+    file.write(reinterpret_cast<const char *>(&forged), sizeof(forged));
+  }
+  CHECK_THROWS_AS(DiscreteLogTable::Load(path, group), std::runtime_error);
+  std::filesystem::remove(path);
+}
@@ -0,0 +1,215 @@
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "../include-shared/constants.hpp"
+#include "../include-shared/group.hpp"
+#include "../include/drivers/crypto_driver.hpp"
+#include "../include/pkg/election.hpp"
+
+namespace {
+/**
+ * An election key pair.
+ */
+std::pair<CryptoPP::Integer, CryptoPP::Integer> election_keys() {
+  CryptoDriver crypto_driver;
+  return crypto_driver.EG_generate();
+}
+
+/**
+ * Ballots for votes 0 and 1 alternately, with full or compact proofs.
+ */
+std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>>
+generate_votes(const CryptoPP::Integer &pk, size_t count, bool compact) {
+  ElectionClient::UseCompactProofs(compact);
+  std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes;
+  for (size_t i = 0; i < count; i++) {
+    votes.push_back(
+        ElectionClient::GenerateVote(CryptoPP::Integer((long)(i % 2)), pk));
+  }
+  ElectionClient::UseCompactProofs(false);
+  return votes;
+}
+} // namespace
+
+TEST_CASE("vote proofs with out-of-range scalars are rejected") {
+  auto [sk, pk] = election_keys();
+  const CryptoPP::Integer &q = ElectionGroup()->Order();
+  for (bool compact : {false, true}) {
+    std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes =
+        generate_votes(pk, 4, compact);
+    for (const auto &vote : votes) {
+      CHECK(ElectionClient::VerifyVoteZKP(vote, pk));
+    }
+    votes[0].second.r0 -= q;
+    votes[1].second.c1 += q;
+    votes[2].second.r1 = -votes[2].second.r1;
+    CHECK_FALSE(ElectionClient::VerifyVoteZKP(votes[0], pk));
+    CHECK_FALSE(ElectionClient::VerifyVoteZKP(votes[1], pk));
+    CHECK_FALSE(ElectionClient::VerifyVoteZKP(votes[2], pk));
+    CHECK(ElectionClient::VerifyVoteZKPBatch(votes, pk) ==
+          std::vector<bool>{false, false, false, true});
+  }
+}
+
+TEST_CASE("combining votes skips rows with the wrong candidate count") {
+  auto [sk, pk] = election_keys();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  // The malformed row first, where the candidate count was once taken from,
+  // then in the middle.
+  for (size_t bad : {0, 1}) {
+    std::vector<VoteRow> rows(3);
+    std::vector<Vote_Ciphertext> expected(2);
+    for (Vote_Ciphertext &ct : expected) {
+      ct.a = group->Identity();
+      ct.b = group->Identity();
+    }
+    for (size_t r = 0; r < rows.size(); r++) {
+      size_t candidates = r == bad ? 1 : 2;
+      for (size_t i = 0; i < candidates; i++) {
+        Vote_Ciphertext ct =
+            ElectionClient::GenerateVote(CryptoPP::Integer((long)i), pk).first;
+        rows[r].votes.ct.push_back(ct);
+        if (r != bad) {
+          expected[i].a = group->Mul(expected[i].a, ct.a);
+          expected[i].b = group->Mul(expected[i].b, ct.b);
+        }
+      }
+    }
+
+    CHECK(ElectionClient::CandidateCount(rows) == 2);
+    std::vector<Vote_Ciphertext> combined =
+        ElectionClient::CombineVotes(rows, 2);
+    REQUIRE(combined.size() == 2);
+    for (size_t i = 0; i < combined.size(); i++) {
+      CHECK(combined[i].a == expected[i].a);
+      CHECK(combined[i].b == expected[i].b);
+    }
+  }
+}
+
+TEST_CASE("combining no votes gives the identity for every candidate") {
+  std::shared_ptr<const Group> group = ElectionGroup();
+  CHECK(ElectionClient::CandidateCount({}) == 0);
+  std::vector<Vote_Ciphertext> combined = ElectionClient::CombineVotes({}, 3);
+  REQUIRE(combined.size() == 3);
+  for (const Vote_Ciphertext &ct : combined) {
+    CHECK(ct.a == group->Identity());
+    CHECK(ct.b == group->Identity());
+  }
+}
+
+TEST_CASE("votes drawn from the precomputation pool verify") {
+  auto [sk, pk] = election_keys();
+  ElectionClient::StartVotePrecomputation(pk, 4);
+  for (long vote = 0; vote < 8; vote++) {
+    CHECK(ElectionClient::VerifyVoteZKP(
+        ElectionClient::GenerateVote(CryptoPP::Integer(vote % 2), pk), pk));
+  }
+  ElectionClient::StartVotePrecomputation(pk, 0);
+}
+
+TEST_CASE("batch vote verification flags exactly the tampered proofs") {
+  auto [sk, pk] = election_keys();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  for (bool compact : {false, true}) {
+    std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes =
+        generate_votes(pk, 9, compact);
+    CHECK(ElectionClient::VerifyVoteZKPBatch(votes, pk) ==
+          std::vector<bool>(9, true));
+
+    // A compact proof has no commitments to tamper with, only scalars.
+    if (!compact) {
+      votes[2].second.a0 = group->Mul(votes[2].second.a0, group->Generator());
+    }
+    votes[5].second.c0 = (votes[5].second.c0 + 1) % group->Order();
+    votes[7].second.r1 = (votes[7].second.r1 + 1) % group->Order();
+    votes[8].first.b = group->Mul(votes[8].first.b, group->Generator());
+    std::vector<bool> valid = ElectionClient::VerifyVoteZKPBatch(votes, pk);
+    REQUIRE(valid.size() == votes.size());
+    for (size_t i = 0; i < votes.size(); i++) {
+      bool tampered = (i == 2 && !compact) || i == 5 || i == 7 || i == 8;
+      CHECK(valid[i] == !tampered);
+      CHECK(ElectionClient::VerifyVoteZKP(votes[i], pk) == valid[i]);
+    }
+  }
+}
+
+TEST_CASE("vote proofs with small-order commitments are rejected") {
+  auto [sk, pk] = election_keys();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  if (group->Name() != GROUP_MODP_2048) {
+    return;
+  }
+  // p - 1 has order 2; the batch's random exponents must not cancel it.
+  std::vector<std::pair<Vote_Ciphertext, VoteZKP_Struct>> votes =
+      generate_votes(pk, 4, false);
+  votes[1].second.a0 = group->Mul(votes[1].second.a0, DL_P - 1);
+  votes[2].second.b1 = group->Mul(votes[2].second.b1, DL_P - 1);
+  CHECK_FALSE(ElectionClient::VerifyVoteZKP(votes[1], pk));
+  CHECK_FALSE(ElectionClient::VerifyVoteZKP(votes[2], pk));
+  for (int round = 0; round < 8; round++) {
+    CHECK(ElectionClient::VerifyVoteZKPBatch(votes, pk) ==
+          std::vector<bool>{true, false, false, true});
+  }
+}
+
+TEST_CASE("compact vote proofs survive the wire and still verify") {
+  auto [sk, pk] = election_keys();
+  std::pair<Vote_Ciphertext, VoteZKP_Struct> vote =
+      generate_votes(pk, 1, true)[0];
+  std::vector<unsigned char> data;
+  vote.second.serialize(data);
+  VoteZKP_Struct decoded;
+  decoded.deserialize(data);
+  CHECK(decoded.compact);
+  CHECK(ElectionClient::VerifyVoteZKP({vote.first, decoded}, pk));
+
+  // The proof is for this ciphertext and this key only.
+  auto [other_sk, other_pk] = election_keys();
+  CHECK_FALSE(ElectionClient::VerifyVoteZKP({vote.first, decoded}, other_pk));
+  Vote_Ciphertext other = generate_votes(pk, 1, true)[0].first;
+  CHECK_FALSE(ElectionClient::VerifyVoteZKP({other, decoded}, pk));
+}
+
+TEST_CASE("partial decryption proofs verify in either form") {
+  auto [sk, pk] = election_keys();
+  std::shared_ptr<const Group> group = ElectionGroup();
+  Vote_Ciphertext vote =
+      ElectionClient::GenerateVote(CryptoPP::Integer::One(), pk).first;
+  for (bool compact : {false, true}) {
+    ElectionClient::UseCompactProofs(compact);
+    auto [dec, zkp] = ElectionClient::PartialDecrypt(vote, pk, sk);
+    ElectionClient::UseCompactProofs(false);
+    CHECK(zkp.compact == compact);
+
+    ArbiterToWorld_PartialDecryption_Message msg;
+    msg.dec = dec;
+    msg.zkp = zkp;
+    std::vector<unsigned char> data;
+    msg.serialize(data);
+    ArbiterToWorld_PartialDecryption_Message decoded;
+    decoded.deserialize(data);
+    CHECK(ElectionClient::VerifyPartialDecryptZKP(decoded, pk));
+
+    ArbiterToWorld_PartialDecryption_Message tampered = decoded;
+    tampered.dec.d = group->Mul(tampered.dec.d, group->Generator());
+    CHECK_FALSE(ElectionClient::VerifyPartialDecryptZKP(tampered, pk));
+    tampered = decoded;
+    tampered.zkp.s = (tampered.zkp.s + 1) % group->Order();
+    CHECK_FALSE(ElectionClient::VerifyPartialDecryptZKP(tampered, pk));
+
+    // The same response plus q passes the equations; it must not pass.
+    tampered = decoded;
+    tampered.zkp.s += group->Order();
+    CHECK_FALSE(ElectionClient::VerifyPartialDecryptZKP(tampered, pk));
+    tampered = decoded;
+    tampered.zkp.s = -tampered.zkp.s;
+    CHECK_FALSE(ElectionClient::VerifyPartialDecryptZKP(tampered, pk));
+    if (compact) {
+      tampered = decoded;
+      tampered.zkp.c += group->Order();
+      CHECK_FALSE(ElectionClient::VerifyPartialDecryptZKP(tampered, pk));
+    }
+  }
+}
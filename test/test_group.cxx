@@ -0,0 +1,68 @@
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "../include-shared/constants.hpp"
+#include "../include-shared/group.hpp"
+
+TEST_CASE("MODP elements must lie in the order-q subgroup") {
+  std::shared_ptr<const Group> group = MakeGroup(GROUP_MODP_2048);
+  CHECK(group->IsElement(group->Identity()));
+  CHECK(group->IsElement(group->Generator()));
+  CHECK(group->IsElement(group->ExpGenerator(CryptoPP::Integer(12345))));
+
+  // p - 1 has order 2, and 2 generates far more than the subgroup.
+  CHECK_FALSE(group->IsElement(DL_P - 1));
+  CHECK_FALSE(group->IsElement(CryptoPP::Integer(2)));
+  CHECK_FALSE(group->IsElement(group->Mul(group->Generator(), DL_P - 1)));
+  CHECK_FALSE(group->IsElement(CryptoPP::Integer::Zero()));
+  CHECK_FALSE(group->IsElement(DL_P));
+}
+
+TEST_CASE("curve elements must be points on the curve") {
+  std::shared_ptr<const Group> group = MakeGroup(GROUP_SECP256R1);
+  CryptoPP::Integer x = group->ExpGenerator(CryptoPP::Integer(12345));
+  CHECK(group->IsElement(x));
+  // A compressed point starts with 02 or 03; 04 or 05 is not one.
+  CHECK_FALSE(group->IsElement(x + CryptoPP::Integer::Power2(8 * 32 + 1)));
+}
+
+TEST_CASE("every thread sees the same election group") {
+  const Group *first = ElectionGroup().get();
+  REQUIRE(first != nullptr);
+  std::vector<const Group *> seen(4);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < seen.size(); i++) {
+    threads.emplace_back([&, i]() { seen[i] = ElectionGroup().get(); });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+  for (const Group *group : seen) {
+    CHECK(group == first);
+  }
+}
+
+TEST_CASE("curve groups made and destroyed in turn compute correctly") {
+  // Groups made and destroyed in turn tend to reuse one address.
+  std::shared_ptr<const Group> reference = MakeGroup(GROUP_SECP256R1);
+  CryptoPP::Integer x = reference->ExpGenerator(CryptoPP::Integer(12345));
+  CryptoPP::Integer y = reference->ExpGenerator(CryptoPP::Integer(678));
+  CryptoPP::Integer expected = reference->Mul(x, y);
+  for (int round = 0; round < 4; round++) {
+    std::shared_ptr<const Group> group = MakeGroup(GROUP_SECP256R1);
+    CHECK(group->Mul(x, y) == expected);
+    CHECK(group->Exp(x, CryptoPP::Integer(2)) == group->Mul(x, x));
+  }
+}
+
+TEST_CASE("the cached generator inverse undoes the generator") {
+  for (const char *name : {GROUP_MODP_2048, GROUP_SECP256R1}) {
+    std::shared_ptr<const Group> group = MakeGroup(name);
+    CHECK(group->Mul(group->Generator(), group->GeneratorInverse()) ==
+          group->Identity());
+    CHECK(group->GeneratorInverse() == group->Inverse(group->Generator()));
+  }
+}
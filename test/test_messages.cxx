@@ -0,0 +1,410 @@
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "doctest/doctest.h"
+
+#include "../include-shared/messages.hpp"
+
+namespace {
+/**
+ * A sum proof with count entries of small, distinct values.
+ */
+SumZKP_Struct sum_proof(size_t count) {
+  SumZKP_Struct proof;
+  for (size_t i = 0; i < count; i++) {
+    proof.a.push_back(CryptoPP::Integer((long)(4 * i + 1)));
+    proof.b.push_back(CryptoPP::Integer((long)(4 * i + 2)));
+    proof.c.push_back(CryptoPP::Integer((long)(4 * i + 3)));
+    proof.r.push_back(CryptoPP::Integer((long)(4 * i + 4)));
+  }
+  return proof;
+}
+
+/**
+ * A sum proof header claiming count entries, with no entries behind it.
+ */
+std::vector<unsigned char> sum_proof_header(const CryptoPP::Integer &count) {
+  std::vector<unsigned char> data;
+  data.push_back((char)MessageType::SumZKP_Struct);
+  put_integer(count, data);
+  return data;
+}
+
+/**
+ * A vote proof with small, distinct values in every field.
+ */
+VoteZKP_Struct vote_proof() {
+  VoteZKP_Struct proof;
+  long value = 1;
+  for (CryptoPP::Integer *x : {&proof.a0, &proof.a1, &proof.b0, &proof.b1,
+                               &proof.c0, &proof.c1, &proof.r0, &proof.r1}) {
+    *x = CryptoPP::Integer(value++);
+  }
+  return proof;
+}
+
+/**
+ * count vote ciphertexts of small, distinct values.
+ */
+Multi_Vote_Ciphertext vote_ciphertexts(size_t count) {
+  Multi_Vote_Ciphertext votes;
+  for (size_t i = 0; i < count; i++) {
+    Vote_Ciphertext &ct = votes.ct.emplace_back();
+    ct.a = CryptoPP::Integer((long)(2 * i + 1));
+    ct.b = CryptoPP::Integer((long)(2 * i + 2));
+  }
+  return votes;
+}
+
+/**
+ * Appends digits to data as the original encoding wrote an integer: its
+ * length as a size_t, then its decimal digits.
+ */
+void put_decimal(const std::string &digits, std::vector<unsigned char> &data) {
+  size_t length = digits.size();
+  size_t idx = data.size();
+  data.resize(idx + sizeof(size_t));
+  std::memcpy(&data[idx], &length, sizeof(size_t));
+  data.insert(data.end(), digits.begin(), digits.end());
+}
+
+/**
+ * Whether serialized_size is exactly what serialize appends, in both integer
+ * encodings and behind bytes already in the buffer.
+ */
+bool size_matches(Serializable &message) {
+  for (WireVersion::T version : {WireVersion::BINARY, WireVersion::DECIMAL}) {
+    message.wire_version = version;
+    std::vector<unsigned char> data(3, 0xAB);
+    message.serialize(data);
+    if (data.size() - 3 != message.serialized_size()) {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+TEST_CASE("sum proofs round-trip") {
+  SumZKP_Struct proof = sum_proof(3);
+  std::vector<unsigned char> data;
+  proof.serialize(data);
+  CHECK(data.size() == proof.serialized_size());
+
+  SumZKP_Struct decoded;
+  CHECK(decoded.deserialize(data) == (int)data.size());
+  CHECK(decoded.a == proof.a);
+  CHECK(decoded.b == proof.b);
+  CHECK(decoded.c == proof.c);
+  CHECK(decoded.r == proof.r);
+}
+
+TEST_CASE("sum proofs reject counts their length cannot hold") {
+  SumZKP_Struct decoded;
+  CHECK_THROWS_AS(decoded.deserialize(sum_proof_header(CryptoPP::Integer(-1))),
+                  std::runtime_error);
+  CHECK_THROWS_AS(
+      decoded.deserialize(sum_proof_header(CryptoPP::Integer(1L << 40))),
+      std::runtime_error);
+  CHECK_THROWS_AS(
+      decoded.deserialize(sum_proof_header(CryptoPP::Integer::Power2(80))),
+      std::runtime_error);
+  CHECK(decoded.a.empty());
+
+  std::vector<unsigned char> data = sum_proof_header(CryptoPP::Integer(2));
+  data.resize(data.size() + 7);
+  CHECK_THROWS_AS(decoded.deserialize(data), std::runtime_error);
+}
+
+TEST_CASE("truncated sum proofs are rejected") {
+  std::vector<unsigned char> data;
+  sum_proof(2).serialize(data);
+  data.pop_back();
+  SumZKP_Struct decoded;
+  CHECK_THROWS_AS(decoded.deserialize(data), std::runtime_error);
+}
+
+TEST_CASE("compact vote proofs carry only their scalars") {
+  VoteZKP_Struct proof = vote_proof();
+  std::vector<unsigned char> full;
+  proof.serialize(full);
+  CHECK(full.size() == proof.serialized_size());
+  VoteZKP_Struct decoded;
+  CHECK(decoded.deserialize(full) == (int)full.size());
+  CHECK_FALSE(decoded.compact);
+  CHECK(decoded.a0 == proof.a0);
+  CHECK(decoded.b1 == proof.b1);
+  CHECK(decoded.r1 == proof.r1);
+
+  proof.compact = true;
+  std::vector<unsigned char> compact;
+  proof.serialize(compact);
+  CHECK(compact.size() == proof.serialized_size());
+  CHECK(compact.size() < full.size());
+  VoteZKP_Struct decoded_compact;
+  CHECK(decoded_compact.deserialize(compact) == (int)compact.size());
+  CHECK(decoded_compact.compact);
+  CHECK(decoded_compact.c0 == proof.c0);
+  CHECK(decoded_compact.c1 == proof.c1);
+  CHECK(decoded_compact.r0 == proof.r0);
+  CHECK(decoded_compact.r1 == proof.r1);
+  CHECK(decoded_compact.a0 == CryptoPP::Integer::Zero());
+}
+
+TEST_CASE("compact decryption proofs carry only (c, s)") {
+  DecryptionZKP_Struct proof;
+  proof.u = CryptoPP::Integer(11);
+  proof.v = CryptoPP::Integer(12);
+  proof.s = CryptoPP::Integer(13);
+  proof.c = CryptoPP::Integer(14);
+  proof.compact = true;
+  std::vector<unsigned char> data;
+  proof.serialize(data);
+  CHECK(data.size() == proof.serialized_size());
+
+  DecryptionZKP_Struct decoded;
+  CHECK(decoded.deserialize(data) == (int)data.size());
+  CHECK(decoded.compact);
+  CHECK(decoded.c == proof.c);
+  CHECK(decoded.s == proof.s);
+  CHECK(decoded.u == CryptoPP::Integer::Zero());
+}
+
+TEST_CASE("truncated compact proofs are rejected") {
+  VoteZKP_Struct vote = vote_proof();
+  vote.compact = true;
+  std::vector<unsigned char> data;
+  vote.serialize(data);
+  data.pop_back();
+  VoteZKP_Struct decoded_vote;
+  CHECK_THROWS_AS(decoded_vote.deserialize(data), std::runtime_error);
+
+  DecryptionZKP_Struct dec;
+  dec.s = CryptoPP::Integer(13);
+  dec.c = CryptoPP::Integer(14);
+  dec.compact = true;
+  data.clear();
+  dec.serialize(data);
+  data.pop_back();
+  DecryptionZKP_Struct decoded_dec;
+  CHECK_THROWS_AS(decoded_dec.deserialize(data), std::runtime_error);
+}
+
+TEST_CASE("key exchange messages carry the channel mode") {
+  UserToServer_DHPublicValue_Message msg;
+  const unsigned char public_value[] = {1, 2, 3, 4};
+  msg.public_value = CryptoPP::SecByteBlock(public_value, 4);
+  msg.channel_mode = ChannelMode::AES_GCM;
+  std::vector<unsigned char> data;
+  msg.serialize(data);
+  CHECK(data.size() == msg.serialized_size());
+
+  UserToServer_DHPublicValue_Message decoded;
+  CHECK(decoded.deserialize(data) == (int)data.size());
+  CHECK(decoded.channel_mode == ChannelMode::AES_GCM);
+  CHECK(decoded.public_value == msg.public_value);
+
+  // Clients that predate channel modes send no mode byte.
+  data.pop_back();
+  UserToServer_DHPublicValue_Message legacy;
+  CHECK(legacy.deserialize(data) == (int)data.size());
+  CHECK(legacy.channel_mode == ChannelMode::CBC_HMAC);
+
+  data.pop_back();
+  CHECK_THROWS_AS(legacy.deserialize(data), std::runtime_error);
+}
+
+TEST_CASE("decimal-encoded messages read and write back byte for byte") {
+  std::vector<unsigned char> ct_bytes;
+  ct_bytes.push_back((char)MessageType::Vote_Ciphertext);
+  put_decimal("123456789012", ct_bytes);
+  put_decimal("7", ct_bytes);
+
+  Vote_Ciphertext ct;
+  CHECK(ct.deserialize(ct_bytes) == (int)ct_bytes.size());
+  CHECK(ct.wire_version == WireVersion::DECIMAL);
+  CHECK(ct.a == CryptoPP::Integer("123456789012"));
+  CHECK(ct.b == CryptoPP::Integer(7L));
+  CHECK(ct.serialized_size() == ct_bytes.size());
+  std::vector<unsigned char> ct_again;
+  ct.serialize(ct_again);
+  CHECK(ct_again == ct_bytes);
+
+  std::vector<unsigned char> zkp_bytes;
+  zkp_bytes.push_back((char)MessageType::VoteZKP_Struct);
+  for (const char *digits : {"1", "22", "333", "4444", "0", "6", "77", "8"}) {
+    put_decimal(digits, zkp_bytes);
+  }
+
+  VoteZKP_Struct zkp;
+  CHECK(zkp.deserialize(zkp_bytes) == (int)zkp_bytes.size());
+  CHECK(zkp.wire_version == WireVersion::DECIMAL);
+  CHECK(zkp.b1 == CryptoPP::Integer(4444L));
+  CHECK(zkp.c0 == CryptoPP::Integer::Zero());
+  std::vector<unsigned char> zkp_again;
+  zkp.serialize(zkp_again);
+  CHECK(zkp_again == zkp_bytes);
+
+  // A new message still goes out in the binary encoding.
+  Vote_Ciphertext fresh;
+  fresh.a = ct.a;
+  fresh.b = ct.b;
+  std::vector<unsigned char> fresh_bytes;
+  fresh.serialize(fresh_bytes);
+  CHECK(fresh_bytes != ct_bytes);
+  Vote_Ciphertext fresh_read;
+  fresh_read.deserialize(fresh_bytes);
+  CHECK(fresh_read.wire_version == WireVersion::BINARY);
+  CHECK(fresh_read.a == ct.a);
+}
+
+TEST_CASE("serialized sizes match the bytes written for every message") {
+  CryptoPP::Integer big("123456789012");
+  CryptoPP::Integer negative("-5");
+
+  Vote_Ciphertext ct;
+  ct.a = big;
+  ct.b = negative;
+  CHECK(size_matches(ct));
+
+  Multi_Vote_Ciphertext cts;
+  cts.ct.push_back(ct);
+  cts.ct.push_back(ct);
+  Multi_Integer ints;
+  ints.ints.push_back(big);
+  ints.ints.push_back(CryptoPP::Integer::Zero());
+  Multi_String strings;
+  strings.strings.push_back("first");
+  strings.strings.push_back("");
+  for (bool counted : {true, false}) {
+    cts.counted = ints.counted = strings.counted = counted;
+    CHECK(size_matches(cts));
+    CHECK(size_matches(ints));
+    CHECK(size_matches(strings));
+  }
+
+  VoteZKP_Struct zkp = vote_proof();
+  Multi_VoteZKP_Struct zkps;
+  zkps.zkp.push_back(zkp);
+  zkp.compact = true;
+  zkps.zkp.push_back(zkp);
+  CHECK(size_matches(zkp));
+  SumZKP_Struct sum = sum_proof(3);
+  CHECK(size_matches(sum));
+  CHECK(size_matches(zkps));
+  zkps.sum = sum;
+  CHECK(size_matches(zkps));
+
+  HMACTagged_Wrapper wrapper;
+  wrapper.payload = {1, 2, 3};
+  wrapper.iv = CryptoPP::SecByteBlock(16);
+  wrapper.mac = "mac";
+  CHECK(size_matches(wrapper));
+
+  UserToServer_DHPublicValue_Message user_dh;
+  user_dh.public_value = CryptoPP::SecByteBlock(8);
+  CHECK(size_matches(user_dh));
+  ServerToUser_DHPublicValue_Message server_dh;
+  server_dh.server_public_value = CryptoPP::SecByteBlock(8);
+  server_dh.user_public_value = CryptoPP::SecByteBlock(4);
+  server_dh.server_signature = "signature";
+  server_dh.session_ticket = "ticket";
+  CHECK(size_matches(server_dh));
+  UserToServer_Resume_Message resume;
+  resume.session_ticket = "ticket";
+  resume.client_nonce = CryptoPP::SecByteBlock(16);
+  CHECK(size_matches(resume));
+  ServerToUser_Resume_Message resumed;
+  resumed.accepted = true;
+  resumed.server_nonce = CryptoPP::SecByteBlock(16);
+  resumed.server_confirmation = "confirmation";
+  CHECK(size_matches(resumed));
+
+  VoterToRegistrar_Register_Message register_one;
+  register_one.id = "voter";
+  register_one.vote = big;
+  CHECK(size_matches(register_one));
+  RegistrarToVoter_Blind_Signature_Message signature_one;
+  signature_one.id = "voter";
+  signature_one.registrar_signature = big;
+  CHECK(size_matches(signature_one));
+  VoterToRegistrar_Register_Messages register_all;
+  register_all.id = "voter";
+  register_all.votes = ints;
+  CHECK(size_matches(register_all));
+  RegistrarToVoter_Blind_Signature_Messages signature_all;
+  signature_all.id = "voter";
+  signature_all.registrar_signatures = ints;
+  CHECK(size_matches(signature_all));
+
+  VoterToTallyer_Vote_Message vote;
+  vote.votes = cts;
+  vote.unblinded_signatures = ints;
+  vote.zkps = zkps;
+  CHECK(size_matches(vote));
+  TallyerToWorld_Vote_Message published;
+  published.votes = cts;
+  published.zkps = zkps;
+  published.unblinded_signatures = ints;
+  published.tallyer_signatures = "signature";
+  CHECK(size_matches(published));
+
+  ArbiterToWorld_PartialDecryption_Message partial;
+  partial.arbiter_id = "arbiter";
+  partial.arbiter_vk_path = "arbiter.pub";
+  partial.dec.d = big;
+  partial.dec.aggregate_ciphertext = ct;
+  partial.zkp.u = big;
+  partial.zkp.v = big;
+  partial.zkp.s = CryptoPP::Integer(3L);
+  partial.zkp.c = CryptoPP::Integer(4L);
+  CHECK(size_matches(partial.dec));
+  CHECK(size_matches(partial.zkp));
+  CHECK(size_matches(partial));
+  partial.zkp.compact = true;
+  CHECK(size_matches(partial));
+}
+
+TEST_CASE("containers round-trip counted and uncounted") {
+  for (bool counted : {true, false}) {
+    Multi_Vote_Ciphertext votes = vote_ciphertexts(3);
+    votes.counted = counted;
+    std::vector<unsigned char> data;
+    votes.serialize(data);
+    CHECK(data.size() == votes.serialized_size());
+
+    Multi_Vote_Ciphertext decoded;
+    CHECK(decoded.deserialize(data) == (int)data.size());
+    CHECK(decoded.counted == counted);
+    REQUIRE(decoded.ct.size() == 3);
+    for (size_t i = 0; i < 3; i++) {
+      CHECK(decoded.ct[i].a == votes.ct[i].a);
+      CHECK(decoded.ct[i].b == votes.ct[i].b);
+    }
+    // Containers keep the form they were read in.
+    std::vector<unsigned char> again;
+    decoded.serialize(again);
+    CHECK(again == data);
+  }
+}
+
+TEST_CASE("counted containers reject counts that disagree with them") {
+  std::vector<unsigned char> data;
+  vote_ciphertexts(3).serialize(data);
+  for (size_t count : {size_t(2), size_t(4), size_t(1) << 40}) {
+    std::vector<unsigned char> forged = data;
+    std::memcpy(&forged[1], &count, sizeof(size_t));
+    Multi_Vote_Ciphertext decoded;
+    CHECK_THROWS_AS(decoded.deserialize(forged), std::runtime_error);
+  }
+}
+
+TEST_CASE("truncated counted containers are rejected") {
+  std::vector<unsigned char> data;
+  vote_ciphertexts(3).serialize(data);
+  data.pop_back();
+  Multi_Vote_Ciphertext decoded;
+  CHECK_THROWS_AS(decoded.deserialize(data), std::runtime_error);
+}
@@ -0,0 +1,57 @@
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "doctest/doctest.h"
+
+#include "../include-shared/rng.hpp"
+
+namespace {
+/**
+ * 32 bytes from the calling thread's generator.
+ */
+std::vector<CryptoPP::byte> draw() {
+  std::vector<CryptoPP::byte> block(32);
+  ThreadRNG().GenerateBlock(block.data(), block.size());
+  return block;
+}
+} // namespace
+
+TEST_CASE("each thread draws from its own generator") {
+  CryptoPP::RandomNumberGenerator *mine = &ThreadRNG();
+  CHECK(&ThreadRNG() == mine);
+
+  CryptoPP::RandomNumberGenerator *theirs = nullptr;
+  std::vector<CryptoPP::byte> their_block;
+  std::thread other([&]() {
+    theirs = &ThreadRNG();
+    their_block = draw();
+  });
+  other.join();
+  CHECK(theirs != mine);
+  CHECK(draw() != their_block);
+}
+
+TEST_CASE("a forked child does not repeat its parent's randomness") {
+  draw(); // seed this thread's generator before forking
+  int fds[2];
+  REQUIRE(pipe(fds) == 0);
+  pid_t pid = fork();
+  REQUIRE(pid >= 0);
+  if (pid == 0) {
+    std::vector<CryptoPP::byte> block = draw();
+    ssize_t written = write(fds[1], block.data(), block.size());
+    _exit(written == (ssize_t)block.size() ? 0 : 1);
+  }
+  close(fds[1]);
+  std::vector<CryptoPP::byte> child_block(32);
+  ssize_t got = read(fds[0], child_block.data(), child_block.size());
+  close(fds[0]);
+  int status = 0;
+  waitpid(pid, &status, 0);
+  REQUIRE(got == (ssize_t)child_block.size());
+  CHECK(WIFEXITED(status));
+  CHECK(draw() != child_block);
+}